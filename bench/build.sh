@@ -0,0 +1,69 @@
+#!/bin/bash
+
+# Builds the benchmarks, the native test tools and the tools in tools/ into
+# bench/build/. Benchmarks that parse need the tree-sitter runtime library,
+# found with pkg-config; without it only the lexer and scanner
+# microbenchmarks are built.
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+OUT=bench/build
+CC="${CC:-cc}"
+CFLAGS="${CFLAGS:--O2 -g}"
+
+if [ ! -f src/parser.c ]; then
+    echo "src/parser.c not found, run tree-sitter generate first" >&2
+    exit 1
+fi
+
+mkdir -p "$OUT"
+
+$CC $CFLAGS -Isrc -c src/parser.c -o "$OUT/parser.o"
+$CC $CFLAGS -Isrc -c src/scanner.c -o "$OUT/scanner.o"
+GRAMMAR=("$OUT/parser.o" "$OUT/scanner.o")
+
+# Lexer microbenchmarks
+$CC $CFLAGS -Isrc bench/keywords.c "${GRAMMAR[@]}" -o "$OUT/keywords"
+
+# Scanner microbenchmarks
+$CC $CFLAGS -Isrc bench/scanner.c -o "$OUT/scanner"
+
+if ! pkg-config --exists tree-sitter; then
+    echo "tree-sitter runtime not found with pkg-config, only built lexer and scanner benchmarks"
+    exit 0
+fi
+
+TS_CFLAGS=$(pkg-config --cflags tree-sitter)
+TS_LIBS=$(pkg-config --libs tree-sitter)
+
+# Libraries in lib/
+for lib in fir_stream fir_parallel fir_highlight fir_outline; do
+    $CC $CFLAGS $TS_CFLAGS -Ilib -c "lib/$lib.c" -o "$OUT/$lib.o"
+done
+
+$CC $CFLAGS $TS_CFLAGS -Isrc bench/parse.c "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/parse"
+# Identifies the grammar in the validator's result cache
+FINGERPRINT=$(cat src/parser.c src/scanner.c | { sha256sum 2>/dev/null || shasum -a 256; } | cut -c1-32)
+$CC $CFLAGS $TS_CFLAGS -Isrc -DFIR_GRAMMAR_FINGERPRINT="\"$FINGERPRINT\"" test/validate.c "${GRAMMAR[@]}" $TS_LIBS -lpthread -o "$OUT/validate"
+$CC $CFLAGS $TS_CFLAGS -Isrc -Ilib bench/incremental.c "$OUT/fir_highlight.o" "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/incremental"
+$CC $CFLAGS $TS_CFLAGS -Isrc bench/query.c "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/query"
+$CC $CFLAGS $TS_CFLAGS -Isrc bench/folds.c "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/folds"
+$CC $CFLAGS $TS_CFLAGS -Isrc -Ilib bench/outline.c "$OUT/fir_outline.o" "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/outline"
+
+$CC $CFLAGS $TS_CFLAGS -Isrc -Ilib bench/stream.c "$OUT/fir_stream.o" "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/stream"
+$CC $CFLAGS $TS_CFLAGS -Isrc -Ilib bench/parallel.c "$OUT/fir_parallel.o" "$OUT/fir_stream.o" "${GRAMMAR[@]}" $TS_LIBS -lpthread -o "$OUT/parallel"
+$CC $CFLAGS $TS_CFLAGS -Isrc bench/differential.c "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/differential"
+$CC $CFLAGS $TS_CFLAGS -Isrc test/growth.c "${GRAMMAR[@]}" $TS_LIBS -lm -o "$OUT/growth"
+$CC $CFLAGS $TS_CFLAGS -Isrc -Ilib test/highlight_delta.c "$OUT/fir_highlight.o" "${GRAMMAR[@]}" $TS_LIBS -o "$OUT/highlight_delta"
+
+# The recorder for bench/scanner.c wraps the scanner itself
+$CC $CFLAGS $TS_CFLAGS -Isrc bench/scanner_record.c "$OUT/parser.o" $TS_LIBS -o "$OUT/scanner_record"
+
+# The memory benchmark counts the scanner's allocations too
+$CC $CFLAGS -Isrc -DTREE_SITTER_REUSE_ALLOCATOR -c src/scanner.c -o "$OUT/scanner_alloc.o"
+$CC $CFLAGS $TS_CFLAGS -Isrc bench/memory.c "$OUT/parser.o" "$OUT/scanner_alloc.o" $TS_LIBS -o "$OUT/memory"
+
+# Tools
+$CC $CFLAGS $TS_CFLAGS -Isrc tools/parse_service.c "${GRAMMAR[@]}" $TS_LIBS -lpthread -o "$OUT/parse_service"
@@ -0,0 +1,131 @@
+// Loading a corpus of Fir files into memory. Shared by the native benchmarks
+// and tools that need the tree-sitter runtime.
+
+#ifndef FIR_CORPUS_H_
+#define FIR_CORPUS_H_
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct {
+    char *path;
+    char *source;
+    uint32_t length;
+} CorpusFile;
+
+typedef struct {
+    CorpusFile *files;
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t total_bytes;
+} Corpus;
+
+static inline bool corpus__has_fir_extension(const char *path) {
+    size_t len = strlen(path);
+    return len > 4 && strcmp(path + len - 4, ".fir") == 0;
+}
+
+// Read the whole file at `path` into a NUL-terminated buffer, which the caller
+// frees.
+static inline bool corpus_read_file(const char *path, char **source, uint32_t *length) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0 || size > UINT32_MAX) {
+        fclose(f);
+        return false;
+    }
+    char *buffer = malloc((size_t)size + 1);
+    size_t read = fread(buffer, 1, (size_t)size, f);
+    fclose(f);
+    buffer[read] = '\0';
+    *source = buffer;
+    *length = (uint32_t)read;
+    return true;
+}
+
+static inline void corpus__add(Corpus *corpus, const char *path) {
+    char *source;
+    uint32_t length;
+    if (!corpus_read_file(path, &source, &length)) {
+        fprintf(stderr, "warning: can't read %s\n", path);
+        return;
+    }
+    if (corpus->count == corpus->capacity) {
+        corpus->capacity = corpus->capacity ? corpus->capacity * 2 : 64;
+        corpus->files = realloc(corpus->files, corpus->capacity * sizeof(CorpusFile));
+    }
+    CorpusFile *file = &corpus->files[corpus->count++];
+    file->path = strdup(path);
+    file->source = source;
+    file->length = length;
+    corpus->total_bytes += length;
+}
+
+static inline void corpus__walk(Corpus *corpus, const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        fprintf(stderr, "warning: can't open directory %s\n", dir_path);
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        size_t len = strlen(dir_path) + strlen(entry->d_name) + 2;
+        char *path = malloc(len);
+        snprintf(path, len, "%s/%s", dir_path, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                corpus__walk(corpus, path);
+            } else if (S_ISREG(st.st_mode) && corpus__has_fir_extension(path)) {
+                corpus__add(corpus, path);
+            }
+        }
+        free(path);
+    }
+    closedir(dir);
+}
+
+static inline int corpus__compare_paths(const void *a, const void *b) {
+    return strcmp(((const CorpusFile *)a)->path, ((const CorpusFile *)b)->path);
+}
+
+// Load `path`, which is either a single file or a directory that is searched
+// recursively for `.fir` files. Files are sorted by path so runs are
+// comparable.
+static inline Corpus corpus_load(const char *path) {
+    Corpus corpus = {0};
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "error: %s doesn't exist\n", path);
+        return corpus;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        corpus__walk(&corpus, path);
+    } else {
+        corpus__add(&corpus, path);
+    }
+    if (corpus.count > 0) {
+        qsort(corpus.files, corpus.count, sizeof(CorpusFile), corpus__compare_paths);
+    }
+    return corpus;
+}
+
+static inline void corpus_free(Corpus *corpus) {
+    for (uint32_t i = 0; i < corpus->count; i++) {
+        free(corpus->files[i].path);
+        free(corpus->files[i].source);
+    }
+    free(corpus->files);
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+#endif // FIR_CORPUS_H_
@@ -0,0 +1,389 @@
+// Differential runner against the reference implementation's parser.
+//
+// Usage: bench/build/differential -r COMMAND [-n ITERATIONS] [-t SECONDS]
+//                                 [-k TOP] [-v] [--json] [PATH]
+//
+// Parses all `.fir` files under PATH (default: ../fir) with tree-sitter, in
+// process, and with COMMAND, which runs the reference parser on one file: it's
+// run with `sh -c`, with the file's path appended as the last argument, and
+// accepts the file if it exits with status 0. Its output is discarded. Each
+// file is parsed ITERATIONS times (default: 5) by both, and the best time is
+// kept. A run of COMMAND that takes longer than SECONDS (default: 5) is
+// killed, and counts as a timeout.
+//
+// The reference parser runs in its own process, so its time is the CPU time
+// (user and system) of the process, minus the best time of COMMAND on an empty
+// file: the cost of starting the process (and the shell), measured once at
+// the start. What's left is an estimate of the cost of reading and parsing the
+// file. tree-sitter's time is the wall time of ts_parser_parse_string.
+//
+// Tree-sitter accepts a file like test.sh does: the tree has no errors, and
+// covers the whole file. Reports:
+//
+// - the total time of each parser and the ratio of the two, over the files
+//   both accept,
+// - the files that one of them accepts and the other rejects (or times out
+//   on),
+// - the TOP (default: 20) files where tree-sitter is slowest relative to the
+//   reference, by the ratio of their times. Files whose reference time is
+//   less than a tenth of the startup time aren't ranked: the difference is
+//   mostly noise.
+//
+// -v prints the times and results of every file. With --json, prints a single
+// JSON object instead.
+
+#include "corpus.h"
+
+#include <tree_sitter/api.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+const TSLanguage *tree_sitter_fir(void);
+
+typedef enum {
+    VERDICT_ACCEPT,
+    VERDICT_REJECT,   // reference: nonzero exit status; tree-sitter: errors in the tree
+    VERDICT_PARTIAL,  // tree-sitter only: the tree doesn't cover the whole file
+    VERDICT_TIMEOUT,  // reference only
+} Verdict;
+
+static const char *const verdict_names[] = {
+    [VERDICT_ACCEPT] = "accept",
+    [VERDICT_REJECT] = "reject",
+    [VERDICT_PARTIAL] = "partial",
+    [VERDICT_TIMEOUT] = "timeout",
+};
+
+typedef struct {
+    Verdict verdict;
+    double seconds;
+} Run;
+
+typedef struct {
+    uint32_t file;
+    Run tree_sitter;
+    Run reference;  // startup time subtracted
+    double ratio;   // tree-sitter time / reference time, 0 if not ranked
+} FileResult;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double timeval_seconds(struct timeval tv) {
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+// Same as test.sh: `wc -l`, the number of newline characters.
+static uint32_t count_lines(const CorpusFile *file) {
+    uint32_t lines = 0;
+    for (uint32_t i = 0; i < file->length; i++) {
+        if (file->source[i] == '\n') lines++;
+    }
+    return lines;
+}
+
+static Run parse_tree_sitter(TSParser *parser, const CorpusFile *file) {
+    double start = now();
+    TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+    Run run = {VERDICT_ACCEPT, now() - start};
+    TSNode root = ts_tree_root_node(tree);
+    if (ts_node_has_error(root)) {
+        run.verdict = VERDICT_REJECT;
+    } else {
+        uint32_t lines = count_lines(file);
+        if (lines > 0 && ts_node_end_point(root).row < lines - 1) run.verdict = VERDICT_PARTIAL;
+    }
+    ts_tree_delete(tree);
+    return run;
+}
+
+// Run `script` (COMMAND "$1") with `path` as $1, in its own process group so
+// that a timeout kills everything it started. Returns the process's CPU time,
+// or a negative time if the command can't be run.
+static Run run_reference(const char *script, const char *path, double timeout) {
+    Run run = {VERDICT_REJECT, -1};
+    char *args[] = {"sh", "-c", (char *)script, "sh", (char *)path, NULL};
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    pid_t pid;
+    int error = posix_spawn(&pid, "/bin/sh", &actions, &attributes, args, environ);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) return run;
+
+    // Polling doesn't affect the measured time, which is the child's CPU time.
+    double deadline = now() + timeout;
+    struct timespec poll_interval = {0, 100000};
+    int status;
+    struct rusage usage;
+    for (;;) {
+        pid_t done = wait4(pid, &status, WNOHANG, &usage);
+        if (done == pid) break;
+        if (done < 0 && errno != EINTR) return run;
+        if (now() > deadline) {
+            kill(-pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            run.verdict = VERDICT_TIMEOUT;
+            run.seconds = timeout;
+            return run;
+        }
+        nanosleep(&poll_interval, NULL);
+    }
+
+    // The shell's status when the command can't be found or run.
+    if (WIFEXITED(status) && (WEXITSTATUS(status) == 126 || WEXITSTATUS(status) == 127)) return run;
+    run.seconds = timeval_seconds(usage.ru_utime) + timeval_seconds(usage.ru_stime);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) run.verdict = VERDICT_ACCEPT;
+    return run;
+}
+
+// The best of `iterations` runs. A rejected file or a timeout isn't repeated.
+static Run best_reference(const char *script, const char *path, double timeout, int iterations) {
+    Run best = run_reference(script, path, timeout);
+    for (int i = 1; i < iterations && best.verdict == VERDICT_ACCEPT; i++) {
+        Run run = run_reference(script, path, timeout);
+        if (run.seconds >= 0 && run.seconds < best.seconds) best.seconds = run.seconds;
+    }
+    return best;
+}
+
+// Largest ratio first.
+static int compare_ratios(const void *a, const void *b) {
+    const FileResult *x = *(const FileResult *const *)a, *y = *(const FileResult *const *)b;
+    return x->ratio > y->ratio ? -1 : x->ratio < y->ratio;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s -r COMMAND [-n ITERATIONS] [-t SECONDS] [-k TOP] [-v] [--json] [PATH]\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    const char *command = NULL;
+    int iterations = 5;
+    double timeout = 5;
+    int top = 20;
+    bool verbose = false;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            command = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            timeout = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            top = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (command == NULL || iterations < 1 || timeout <= 0 || top < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t script_length = strlen(command) + sizeof(" \"$1\"");
+    char *script = malloc(script_length);
+    snprintf(script, script_length, "%s \"$1\"", command);
+
+    // The startup time, from an empty file.
+    const char *tmpdir = getenv("TMPDIR");
+    char empty_path[4096];
+    snprintf(empty_path, sizeof(empty_path), "%s/differential-XXXXXX.fir", tmpdir ? tmpdir : "/tmp");
+    int empty_fd = mkstemps(empty_path, 4);
+    if (empty_fd < 0) {
+        fprintf(stderr, "error: can't create %s\n", empty_path);
+        return 1;
+    }
+    close(empty_fd);
+    Run startup = {VERDICT_ACCEPT, 0};
+    for (int i = 0; i < iterations; i++) {
+        Run run = run_reference(script, empty_path, timeout);
+        if (run.seconds < 0 || run.verdict == VERDICT_TIMEOUT) {
+            startup = run;
+            break;
+        }
+        if (i == 0 || run.seconds < startup.seconds) startup.seconds = run.seconds;
+    }
+    unlink(empty_path);
+    if (startup.seconds < 0 || startup.verdict == VERDICT_TIMEOUT) {
+        fprintf(stderr, "error: can't run %s\n", command);
+        return 1;
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+
+    FileResult *results = calloc(corpus.count, sizeof(FileResult));
+    FileResult **ranked = malloc(corpus.count * sizeof(FileResult *));
+    uint32_t ranked_count = 0, both_accept = 0, both_reject = 0, disagreements = 0;
+    uint64_t compared_bytes = 0;
+    double tree_sitter_total = 0, reference_total = 0;
+
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const CorpusFile *file = &corpus.files[i];
+        FileResult *result = &results[i];
+        result->file = i;
+
+        result->tree_sitter = parse_tree_sitter(parser, file);
+        for (int iteration = 1; iteration < iterations; iteration++) {
+            Run run = parse_tree_sitter(parser, file);
+            if (run.seconds < result->tree_sitter.seconds) result->tree_sitter.seconds = run.seconds;
+        }
+
+        result->reference = best_reference(script, file->path, timeout, iterations);
+        if (result->reference.seconds < 0) {
+            fprintf(stderr, "error: can't run %s\n", command);
+            return 1;
+        }
+        if (result->reference.verdict != VERDICT_TIMEOUT) {
+            result->reference.seconds -= startup.seconds;
+            if (result->reference.seconds < 0) result->reference.seconds = 0;
+        }
+
+        bool tree_sitter_accepts = result->tree_sitter.verdict == VERDICT_ACCEPT;
+        bool reference_accepts = result->reference.verdict == VERDICT_ACCEPT;
+        if (tree_sitter_accepts && reference_accepts) {
+            both_accept++;
+            compared_bytes += file->length;
+            tree_sitter_total += result->tree_sitter.seconds;
+            reference_total += result->reference.seconds;
+            // Shorter reference times are within the noise of the startup time
+            // that was subtracted from them.
+            if (result->reference.seconds >= startup.seconds / 10) {
+                result->ratio = result->tree_sitter.seconds / result->reference.seconds;
+                ranked[ranked_count++] = result;
+            }
+        } else if (tree_sitter_accepts != reference_accepts) {
+            disagreements++;
+        } else {
+            both_reject++;
+        }
+
+        if (verbose && !json) {
+            printf("%10.1f us %-7s %10.1f us %-7s", result->tree_sitter.seconds * 1e6,
+                   verdict_names[result->tree_sitter.verdict], result->reference.seconds * 1e6,
+                   verdict_names[result->reference.verdict]);
+            if (result->ratio > 0) {
+                printf(" %7.2fx", result->ratio);
+            } else {
+                printf("         ");
+            }
+            printf("  %s\n", file->path);
+        }
+    }
+
+    qsort(ranked, ranked_count, sizeof(FileResult *), compare_ratios);
+    if ((uint32_t)top > ranked_count) top = (int)ranked_count;
+    double ratio = reference_total > 0 ? tree_sitter_total / reference_total : 0;
+    double tree_sitter_mb_per_s = tree_sitter_total > 0 ? (double)compared_bytes / tree_sitter_total / 1e6 : 0;
+    double reference_mb_per_s = reference_total > 0 ? (double)compared_bytes / reference_total / 1e6 : 0;
+
+    if (json) {
+        printf("{\"files\": %u, \"bytes\": %llu, \"iterations\": %d, \"startup_us\": %.3f, \"both_accept\": %u, "
+               "\"both_reject\": %u, \"compared_bytes\": %llu, \"tree_sitter_mb_per_s\": %.3f, "
+               "\"reference_mb_per_s\": %.3f, \"ratio\": %.4f, \"disagreements\": [",
+               corpus.count, (unsigned long long)corpus.total_bytes, iterations, startup.seconds * 1e6, both_accept,
+               both_reject, (unsigned long long)compared_bytes, tree_sitter_mb_per_s, reference_mb_per_s, ratio);
+        bool first = true;
+        for (uint32_t i = 0; i < corpus.count; i++) {
+            const FileResult *result = &results[i];
+            if ((result->tree_sitter.verdict == VERDICT_ACCEPT) == (result->reference.verdict == VERDICT_ACCEPT)) {
+                continue;
+            }
+            printf("%s{\"path\": \"%s\", \"tree_sitter\": \"%s\", \"reference\": \"%s\"}", first ? "" : ", ",
+                   corpus.files[i].path, verdict_names[result->tree_sitter.verdict],
+                   verdict_names[result->reference.verdict]);
+            first = false;
+        }
+        printf("], \"slowest\": [");
+        for (int i = 0; i < top; i++) {
+            const FileResult *result = ranked[i];
+            printf("%s{\"path\": \"%s\", \"ratio\": %.4f, \"tree_sitter_us\": %.3f, \"reference_us\": %.3f}",
+                   i ? ", " : "", corpus.files[result->file].path, result->ratio, result->tree_sitter.seconds * 1e6,
+                   result->reference.seconds * 1e6);
+        }
+        printf("]}\n");
+    } else {
+        printf("files:        %u (%.2f MB), %d iterations\n",
+               corpus.count, (double)corpus.total_bytes / 1e6, iterations);
+        printf("reference:    %s (startup %.1f us, subtracted)\n", command, startup.seconds * 1e6);
+        printf("both accept:  %u files (%.2f MB), both reject: %u, disagree: %u\n",
+               both_accept, (double)compared_bytes / 1e6, both_reject, disagreements);
+        if (both_accept > 0) {
+            printf("tree-sitter:  %.1f ms, %.2f MB/s\n", tree_sitter_total * 1e3, tree_sitter_mb_per_s);
+            printf("reference:    %.1f ms, %.2f MB/s\n", reference_total * 1e3, reference_mb_per_s);
+            printf("ratio:        %.2fx (tree-sitter time / reference time)\n", ratio);
+        }
+
+        if (disagreements > 0) {
+            printf("\ndisagreements (tree-sitter, reference):\n");
+            for (uint32_t i = 0; i < corpus.count; i++) {
+                const FileResult *result = &results[i];
+                if ((result->tree_sitter.verdict == VERDICT_ACCEPT) ==
+                    (result->reference.verdict == VERDICT_ACCEPT)) {
+                    continue;
+                }
+                printf("  %-7s %-7s  %s\n", verdict_names[result->tree_sitter.verdict],
+                       verdict_names[result->reference.verdict], corpus.files[i].path);
+            }
+        }
+
+        if (top > 0) {
+            printf("\nslowest relative to the reference:\n");
+            printf("    ratio  tree-sitter    reference  file\n");
+            for (int i = 0; i < top; i++) {
+                const FileResult *result = ranked[i];
+                printf("  %6.2fx %9.1f us %9.1f us  %s\n", result->ratio, result->tree_sitter.seconds * 1e6,
+                       result->reference.seconds * 1e6, corpus.files[result->file].path);
+            }
+        }
+    }
+
+    free(ranked);
+    free(results);
+    free(script);
+    ts_parser_delete(parser);
+    corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Fold range benchmark.
+//
+// Usage: bench/build/folds [-n ITERATIONS] [-q QUERY] [-v] [--json] [PATH]
+//
+// Parses all `.fir` files under PATH (default: ../fir) once, then computes the
+// fold ranges of each tree ITERATIONS times (default: 10) from the @fold
+// captures of QUERY (default: queries/folds.scm), the way an editor does
+// after a parse. A capture folds the rows from its start to its end, or to the
+// row before when it ends at the start of a line. Captures on one row become
+// one fold, the largest, and single-row captures aren't folds. Parsing isn't
+// included.
+//
+// Reports the time per file (mean, percentiles and the slowest file) and the
+// number of folds. -v prints the time and fold count of every file. With
+// --json, prints a single JSON object instead.
+
+#include "corpus.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+typedef struct {
+    uint32_t start_row;
+    uint32_t end_row;
+} Fold;
+
+typedef struct {
+    Fold *contents;
+    uint32_t size;
+    uint32_t capacity;
+} Folds;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// `samples` must be sorted.
+static double percentile(const double *samples, size_t count, double p) {
+    if (count == 0) return 0;
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return samples[index];
+}
+
+static void folds_push(Folds *folds, Fold fold) {
+    if (folds->size == folds->capacity) {
+        folds->capacity = folds->capacity ? folds->capacity * 2 : 64;
+        folds->contents = realloc(folds->contents, folds->capacity * sizeof(Fold));
+    }
+    folds->contents[folds->size++] = fold;
+}
+
+// Captures come in document order, so captures starting on the same row are
+// next to each other.
+static void compute_folds(const TSQuery *query, TSQueryCursor *cursor, uint32_t fold_capture, const TSTree *tree,
+                          Folds *folds) {
+    folds->size = 0;
+    ts_query_cursor_exec(cursor, query, ts_tree_root_node(tree));
+    TSQueryMatch match;
+    uint32_t capture_index;
+    while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
+        TSQueryCapture capture = match.captures[capture_index];
+        if (capture.index != fold_capture) continue;
+        TSPoint start = ts_node_start_point(capture.node), end = ts_node_end_point(capture.node);
+        uint32_t end_row = end.column == 0 && end.row > start.row ? end.row - 1 : end.row;
+        if (end_row <= start.row) continue;
+        if (folds->size > 0 && folds->contents[folds->size - 1].start_row == start.row) {
+            Fold *last = &folds->contents[folds->size - 1];
+            if (end_row > last->end_row) last->end_row = end_row;
+            continue;
+        }
+        folds_push(folds, (Fold){start.row, end_row});
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ITERATIONS] [-q QUERY] [-v] [--json] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    const char *query_path = "queries/folds.scm";
+    int iterations = 10;
+    bool verbose = false;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            query_path = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (iterations < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const TSLanguage *language = tree_sitter_fir();
+
+    char *query_source;
+    uint32_t query_length;
+    if (!corpus_read_file(query_path, &query_source, &query_length)) {
+        fprintf(stderr, "error: can't read %s\n", query_path);
+        return 1;
+    }
+    uint32_t error_offset;
+    TSQueryError error_type;
+    TSQuery *query = ts_query_new(language, query_source, query_length, &error_offset, &error_type);
+    if (query == NULL) {
+        fprintf(stderr, "error: %s: error %d at byte %u\n", query_path, error_type, error_offset);
+        return 1;
+    }
+    uint32_t fold_capture = UINT32_MAX;
+    for (uint32_t i = 0; i < ts_query_capture_count(query); i++) {
+        uint32_t length;
+        const char *name = ts_query_capture_name_for_id(query, i, &length);
+        if (length == 4 && memcmp(name, "fold", 4) == 0) fold_capture = i;
+    }
+    if (fold_capture == UINT32_MAX) {
+        fprintf(stderr, "error: %s has no @fold captures\n", query_path);
+        return 1;
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, language);
+    TSQueryCursor *cursor = ts_query_cursor_new();
+    Folds folds = {0};
+
+    // Best time of each file, over the iterations.
+    double *times = malloc(corpus.count * sizeof(double));
+    double *sorted = malloc(corpus.count * sizeof(double));
+    uint64_t fold_count = 0;
+    double total_time = 0;
+    uint32_t slowest = 0;
+
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const CorpusFile *file = &corpus.files[i];
+        TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+        double best = 0;
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            double start = now();
+            compute_folds(query, cursor, fold_capture, tree, &folds);
+            double elapsed = now() - start;
+            total_time += elapsed;
+            if (iteration == 0 || elapsed < best) best = elapsed;
+        }
+        times[i] = best;
+        fold_count += folds.size;
+        if (times[i] > times[slowest]) slowest = i;
+        if (verbose && !json) printf("%10.1f us %6u folds  %s\n", best * 1e6, folds.size, file->path);
+        ts_tree_delete(tree);
+    }
+
+    double sum = 0;
+    for (uint32_t i = 0; i < corpus.count; i++) sum += times[i];
+    memcpy(sorted, times, corpus.count * sizeof(double));
+    qsort(sorted, corpus.count, sizeof(double), compare_doubles);
+    double mean_us = sum / corpus.count * 1e6;
+    double p50_us = percentile(sorted, corpus.count, 0.50) * 1e6;
+    double p99_us = percentile(sorted, corpus.count, 0.99) * 1e6;
+    double max_us = sorted[corpus.count - 1] * 1e6;
+    double mb_per_s = (double)corpus.total_bytes * iterations / total_time / 1e6;
+
+    if (json) {
+        printf("{\"query\": \"%s\", \"files\": %u, \"bytes\": %llu, \"iterations\": %d, \"folds\": %llu, "
+               "\"mb_per_s\": %.3f, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}\n",
+               query_path, corpus.count, (unsigned long long)corpus.total_bytes, iterations,
+               (unsigned long long)fold_count, mb_per_s, mean_us, p50_us, p99_us, max_us);
+    } else {
+        printf("query:       %s\n", query_path);
+        printf("files:       %u (%.2f MB), %d iterations\n",
+               corpus.count, (double)corpus.total_bytes / 1e6, iterations);
+        printf("folds:       %llu (%.1f per file)\n", (unsigned long long)fold_count,
+               (double)fold_count / corpus.count);
+        printf("per file:    mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (%s)\n",
+               mean_us, p50_us, p99_us, max_us, corpus.files[slowest].path);
+        printf("throughput:  %.2f MB/s\n", mb_per_s);
+    }
+
+    free(folds.contents);
+    free(sorted);
+    free(times);
+    ts_query_cursor_delete(cursor);
+    ts_parser_delete(parser);
+    ts_query_delete(query);
+    free(query_source);
+    corpus_free(&corpus);
+    return 0;
+}
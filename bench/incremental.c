@@ -0,0 +1,467 @@
+// Incremental reparse benchmark.
+//
+// Usage: bench/build/incremental [-n ITERATIONS] [-q QUERY] [--json] [-v] [PATH]
+//
+// For every `.fir` file under PATH (default: ../fir), replays a script of
+// editor-like edits against the parsed tree. Each edit goes through
+// `ts_tree_edit` and then `ts_parser_parse` with the edited old tree. The
+// edits are:
+//
+// - type:    typing ` + 1` one character at a time at the end of the deepest
+//            line in a `match` arm (or the deepest line, if there's no match)
+// - indent:  indenting a block (the lines after a line ending with `:`) by 4
+//            more columns, as a single edit
+// - string:  inserting `"` at the start of the deepest line, opening a string
+//            that isn't terminated on that line
+// - comment: inserting `#|` at the start of the deepest line
+//
+// Each reparse is timed ITERATIONS times (default: 5) and the fastest time is
+// kept. For each kind of edit reports the number of reparses, mean and max
+// reparse time, and the mean number and total size of the ranges
+// `ts_tree_get_changed_ranges` reports, next to the time of a full parse.
+// -v prints the numbers for every file.
+//
+// With -q (e.g. `-q queries/highlights.scm`), also times updating the
+// highlights after each reparse with `fir_highlight_delta` (lib/fir_highlight.h),
+// next to running the query over the whole new tree, and reports the mean
+// number of changed captures.
+
+#include "corpus.h"
+#include "fir_highlight.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+typedef enum {
+    EDIT_FULL,  // not an edit: a full parse, for comparison
+    EDIT_TYPE,
+    EDIT_INDENT,
+    EDIT_STRING,
+    EDIT_COMMENT,
+    EDIT_KIND_COUNT,
+} EditKind;
+
+static const char *edit_kind_names[EDIT_KIND_COUNT] = {
+    "full", "type", "indent", "string", "comment",
+};
+
+typedef struct {
+    uint32_t reparses;
+    double total_time;
+    double max_time;
+    uint64_t changed_ranges;
+    uint64_t changed_bytes;
+    double delta_time;      // with -q
+    double full_query_time; // with -q
+    uint64_t highlight_changes;
+} EditStats;
+
+typedef struct {
+    char *text;
+    uint32_t length;
+} Document;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static TSPoint point_at(const char *text, uint32_t byte) {
+    TSPoint point = {0, 0};
+    for (uint32_t i = 0; i < byte; i++) {
+        if (text[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
+    }
+    return point;
+}
+
+// Replace `old_length` bytes at `start` in `doc` with `new_text`, and describe
+// the change in `edit`.
+static void apply_edit(Document *doc, uint32_t start, uint32_t old_length, const char *new_text,
+                       uint32_t new_length, TSInputEdit *edit) {
+    edit->start_byte = start;
+    edit->old_end_byte = start + old_length;
+    edit->new_end_byte = start + new_length;
+    edit->start_point = point_at(doc->text, start);
+    edit->old_end_point = point_at(doc->text, start + old_length);
+
+    uint32_t length = doc->length - old_length + new_length;
+    char *text = malloc(length + 1);
+    memcpy(text, doc->text, start);
+    memcpy(text + start, new_text, new_length);
+    memcpy(text + start + new_length, doc->text + start + old_length, doc->length - start - old_length);
+    text[length] = '\0';
+    free(doc->text);
+    doc->text = text;
+    doc->length = length;
+
+    edit->new_end_point = point_at(doc->text, start + new_length);
+}
+
+static uint32_t line_indent(const char *text, uint32_t line_start, uint32_t length) {
+    uint32_t i = line_start;
+    while (i < length && (text[i] == ' ' || text[i] == '\t')) i++;
+    return i - line_start;
+}
+
+static uint32_t line_end(const char *text, uint32_t pos, uint32_t length) {
+    while (pos < length && text[pos] != '\n') pos++;
+    return pos;
+}
+
+static bool is_blank_line(const char *text, uint32_t line_start, uint32_t length) {
+    uint32_t i = line_start + line_indent(text, line_start, length);
+    return i >= length || text[i] == '\n' || text[i] == '\r';
+}
+
+// Start of the most indented non-blank line, preferring lines inside a `match`
+// block. Returns false if the file has no indented line.
+static bool find_deep_line(const char *text, uint32_t length, uint32_t *result) {
+    uint32_t best = 0, best_indent = 0;
+    bool best_in_match = false;
+    int32_t match_indent = -1;  // indentation of the enclosing `match` line
+
+    for (uint32_t start = 0; start < length; start = line_end(text, start, length) + 1) {
+        if (is_blank_line(text, start, length)) continue;
+        uint32_t indent = line_indent(text, start, length);
+        if (match_indent >= 0 && indent <= (uint32_t)match_indent) match_indent = -1;
+        bool in_match = match_indent >= 0;
+        if (indent > 0 && ((in_match && !best_in_match) ||
+                           (in_match == best_in_match && indent > best_indent))) {
+            best = start;
+            best_indent = indent;
+            best_in_match = in_match;
+        }
+        if (match_indent < 0 && strncmp(text + start + indent, "match ", 6) == 0) {
+            match_indent = (int32_t)indent;
+        }
+    }
+
+    *result = best;
+    return best_indent > 0;
+}
+
+// Range of a block: the lines after a line ending with `:` that are indented
+// more than it. Prefers the first block in the second half of the file.
+static bool find_block(const char *text, uint32_t length, uint32_t *block_start, uint32_t *block_end) {
+    bool found = false;
+    for (uint32_t start = 0; start < length; start = line_end(text, start, length) + 1) {
+        uint32_t end = line_end(text, start, length);
+        uint32_t last = end;
+        while (last > start && (text[last - 1] == ' ' || text[last - 1] == '\r')) last--;
+        if (last == start || text[last - 1] != ':' || end >= length) continue;
+
+        uint32_t indent = line_indent(text, start, length);
+        uint32_t body_start = end + 1, body_end = body_start;
+        for (uint32_t line = body_start; line < length; line = line_end(text, line, length) + 1) {
+            if (!is_blank_line(text, line, length) && line_indent(text, line, length) <= indent) break;
+            body_end = line_end(text, line, length);
+            if (body_end < length) body_end++;
+        }
+        if (body_end == body_start) continue;
+
+        *block_start = body_start;
+        *block_end = body_end;
+        found = true;
+        if (start >= length / 2) break;
+    }
+    return found;
+}
+
+typedef struct {
+    TSParser *parser;
+    const TSQuery *query;  // NULL without -q
+    TSQueryCursor *cursor;
+    int iterations;
+    EditStats *stats;      // indexed by EditKind, for all files
+    EditStats *file_stats; // indexed by EditKind, for the current file
+} Bench;
+
+static void record(Bench *bench, EditKind kind, double time, uint32_t ranges, uint64_t bytes) {
+    EditStats *all[2] = {&bench->stats[kind], &bench->file_stats[kind]};
+    for (int i = 0; i < 2; i++) {
+        EditStats *s = all[i];
+        s->reparses++;
+        s->total_time += time;
+        if (time > s->max_time) s->max_time = time;
+        s->changed_ranges += ranges;
+        s->changed_bytes += bytes;
+    }
+}
+
+static void record_highlights(Bench *bench, EditKind kind, double delta_time, double full_time, uint32_t changes) {
+    EditStats *all[2] = {&bench->stats[kind], &bench->file_stats[kind]};
+    for (int i = 0; i < 2; i++) {
+        all[i]->delta_time += delta_time;
+        all[i]->full_query_time += full_time;
+        all[i]->highlight_changes += changes;
+    }
+}
+
+// Time `fir_highlight_delta` between the edited old tree and the new tree, and
+// the query over the whole new tree.
+static void time_highlights(Bench *bench, EditKind kind, const TSTree *old_tree, const TSTree *new_tree,
+                            const TSInputEdit *edit) {
+    double best_delta = 0, best_full = 0;
+    uint32_t changes = 0;
+    for (int i = 0; i < bench->iterations; i++) {
+        FirHighlightDelta delta;
+        double t = now();
+        fir_highlight_delta(bench->query, bench->cursor, old_tree, new_tree, edit, 1, &delta);
+        t = now() - t;
+        if (i == 0 || t < best_delta) best_delta = t;
+        changes = delta.change_count;
+        fir_highlight_delta_delete(&delta);
+
+        t = now();
+        ts_query_cursor_exec(bench->cursor, bench->query, ts_tree_root_node(new_tree));
+        TSQueryMatch match;
+        uint32_t capture_index;
+        while (ts_query_cursor_next_capture(bench->cursor, &match, &capture_index)) {}
+        t = now() - t;
+        if (i == 0 || t < best_full) best_full = t;
+    }
+    record_highlights(bench, kind, best_delta, best_full, changes);
+}
+
+// Apply an edit to `doc` and `*tree`, reparse, and record the time and changed
+// ranges. `*tree` is replaced with the new tree.
+static void edit_and_reparse(Bench *bench, EditKind kind, Document *doc, TSTree **tree,
+                             uint32_t start, uint32_t old_length, const char *new_text, uint32_t new_length) {
+    TSInputEdit edit;
+    apply_edit(doc, start, old_length, new_text, new_length, &edit);
+    ts_tree_edit(*tree, &edit);
+
+    double best = 0;
+    TSTree *new_tree = NULL;
+    for (int i = 0; i < bench->iterations; i++) {
+        if (new_tree) ts_tree_delete(new_tree);
+        double t = now();
+        new_tree = ts_parser_parse_string(bench->parser, *tree, doc->text, doc->length);
+        t = now() - t;
+        if (i == 0 || t < best) best = t;
+    }
+
+    uint32_t range_count;
+    TSRange *ranges = ts_tree_get_changed_ranges(*tree, new_tree, &range_count);
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < range_count; i++) {
+        bytes += ranges[i].end_byte - ranges[i].start_byte;
+    }
+    free(ranges);
+
+    record(bench, kind, best, range_count, bytes);
+    if (bench->query) time_highlights(bench, kind, *tree, new_tree, &edit);
+    ts_tree_delete(*tree);
+    *tree = new_tree;
+}
+
+static void run_file(Bench *bench, const CorpusFile *file) {
+    // Full parse, for comparison
+    double best = 0;
+    TSTree *original = NULL;
+    for (int i = 0; i < bench->iterations; i++) {
+        if (original) ts_tree_delete(original);
+        double t = now();
+        original = ts_parser_parse_string(bench->parser, NULL, file->source, file->length);
+        t = now() - t;
+        if (i == 0 || t < best) best = t;
+    }
+    record(bench, EDIT_FULL, best, 0, 0);
+
+    uint32_t deep_line;
+    bool has_deep_line = find_deep_line(file->source, file->length, &deep_line);
+    uint32_t block_start, block_end;
+    bool has_block = find_block(file->source, file->length, &block_start, &block_end);
+
+    for (EditKind kind = EDIT_TYPE; kind < EDIT_KIND_COUNT; kind++) {
+        if (kind == EDIT_INDENT ? !has_block : !has_deep_line) continue;
+
+        Document doc = {malloc(file->length + 1), file->length};
+        memcpy(doc.text, file->source, file->length + 1);
+        TSTree *tree = ts_tree_copy(original);
+        uint32_t code_start = deep_line + line_indent(file->source, deep_line, file->length);
+
+        switch (kind) {
+            case EDIT_TYPE: {
+                const char *typed = " + 1";
+                uint32_t pos = line_end(file->source, deep_line, file->length);
+                if (pos > deep_line && file->source[pos - 1] == '\r') pos--;
+                for (uint32_t i = 0; typed[i]; i++) {
+                    edit_and_reparse(bench, kind, &doc, &tree, pos + i, 0, typed + i, 1);
+                }
+                break;
+            }
+            case EDIT_INDENT: {
+                // Re-indent each line of the block by 4 spaces.
+                uint32_t old_length = block_end - block_start;
+                char *indented = malloc((size_t)old_length * 5 + 1);
+                uint32_t n = 0;
+                bool at_line_start = true;
+                for (uint32_t i = block_start; i < block_end; i++) {
+                    if (at_line_start && !is_blank_line(file->source, i, file->length)) {
+                        memcpy(indented + n, "    ", 4);
+                        n += 4;
+                    }
+                    indented[n++] = file->source[i];
+                    at_line_start = file->source[i] == '\n';
+                }
+                edit_and_reparse(bench, kind, &doc, &tree, block_start, old_length, indented, n);
+                free(indented);
+                break;
+            }
+            case EDIT_STRING:
+                edit_and_reparse(bench, kind, &doc, &tree, code_start, 0, "\"", 1);
+                break;
+            case EDIT_COMMENT:
+                edit_and_reparse(bench, kind, &doc, &tree, code_start, 0, "#|", 2);
+                break;
+            default:
+                break;
+        }
+
+        ts_tree_delete(tree);
+        free(doc.text);
+    }
+
+    ts_tree_delete(original);
+}
+
+static void print_stats(const EditStats *stats, bool highlights, bool json) {
+    if (json) printf("{");
+    for (EditKind kind = 0; kind < EDIT_KIND_COUNT; kind++) {
+        const EditStats *s = &stats[kind];
+        double mean = s->reparses ? s->total_time / s->reparses : 0;
+        double ranges = s->reparses ? (double)s->changed_ranges / s->reparses : 0;
+        double bytes = s->reparses ? (double)s->changed_bytes / s->reparses : 0;
+        if (json) {
+            printf("%s\"%s\": {\"reparses\": %u, \"mean_ms\": %.4f, \"max_ms\": %.4f, "
+                   "\"mean_changed_ranges\": %.2f, \"mean_changed_bytes\": %.1f}",
+                   kind ? ", " : "", edit_kind_names[kind], s->reparses, mean * 1e3,
+                   s->max_time * 1e3, ranges, bytes);
+            if (highlights && kind != EDIT_FULL) {
+                printf(", \"%s_highlights\": {\"delta_ms\": %.4f, \"full_query_ms\": %.4f, \"mean_changes\": %.2f}",
+                       edit_kind_names[kind], s->reparses ? s->delta_time / s->reparses * 1e3 : 0,
+                       s->reparses ? s->full_query_time / s->reparses * 1e3 : 0,
+                       s->reparses ? (double)s->highlight_changes / s->reparses : 0);
+            }
+        } else if (kind == EDIT_FULL) {
+            printf("  %-8s %6u parses    mean %8.3f ms  max %8.3f ms\n",
+                   edit_kind_names[kind], s->reparses, mean * 1e3, s->max_time * 1e3);
+        } else {
+            printf("  %-8s %6u reparses  mean %8.3f ms  max %8.3f ms  changed: %.1f ranges, %.0f bytes\n",
+                   edit_kind_names[kind], s->reparses, mean * 1e3, s->max_time * 1e3, ranges, bytes);
+            if (highlights && s->reparses) {
+                printf("  %-8s highlights: delta %8.3f ms, whole tree %8.3f ms, %.1f changed captures\n", "",
+                       s->delta_time / s->reparses * 1e3, s->full_query_time / s->reparses * 1e3,
+                       (double)s->highlight_changes / s->reparses);
+            }
+        }
+    }
+    if (json) printf("}");
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ITERATIONS] [-q QUERY] [--json] [-v] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    const char *query_path = NULL;
+    int iterations = 5;
+    bool json = false, verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            query_path = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (iterations < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    EditStats stats[EDIT_KIND_COUNT] = {0};
+    EditStats file_stats[EDIT_KIND_COUNT];
+    Bench bench = {ts_parser_new(), NULL, NULL, iterations, stats, file_stats};
+    ts_parser_set_language(bench.parser, tree_sitter_fir());
+
+    TSQuery *query = NULL;
+    if (query_path) {
+        char *query_source;
+        uint32_t query_length, error_offset;
+        TSQueryError error_type;
+        if (!corpus_read_file(query_path, &query_source, &query_length)) {
+            fprintf(stderr, "error: can't read %s\n", query_path);
+            return 1;
+        }
+        query = ts_query_new(tree_sitter_fir(), query_source, query_length, &error_offset, &error_type);
+        free(query_source);
+        if (query == NULL) {
+            fprintf(stderr, "error: %s: error %d at byte %u\n", query_path, error_type, error_offset);
+            return 1;
+        }
+        bench.query = query;
+        bench.cursor = ts_query_cursor_new();
+    }
+
+    if (json) printf("{\"files\": [");
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        memset(file_stats, 0, sizeof(file_stats));
+        run_file(&bench, &corpus.files[i]);
+        if (!verbose) continue;
+        if (json) {
+            printf("%s{\"path\": \"%s\", \"edits\": ", i ? ", " : "", corpus.files[i].path);
+            print_stats(file_stats, query != NULL, true);
+            printf("}");
+        } else {
+            printf("%s\n", corpus.files[i].path);
+            print_stats(file_stats, query != NULL, false);
+        }
+    }
+
+    if (json) {
+        printf("], \"total\": ");
+        print_stats(stats, query != NULL, true);
+        printf("}\n");
+    } else {
+        printf("%u files, %d iterations\n", corpus.count, iterations);
+        print_stats(stats, query != NULL, false);
+    }
+
+    if (query) {
+        ts_query_cursor_delete(bench.cursor);
+        ts_query_delete(query);
+    }
+    ts_parser_delete(bench.parser);
+    corpus_free(&corpus);
+    return 0;
+}
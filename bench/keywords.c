@@ -0,0 +1,123 @@
+// Microbenchmark for identifier and keyword lexing in the generated lexer.
+//
+// Usage: bench/build/keywords
+//
+// Lexes a buffer of lower- and upper-case identifiers (about a third of them
+// keywords) the way the runtime does: the main lexer matches the identifier,
+// and when it's the `word` token (`lower_id`) the keyword lexer runs over it
+// from the start. The keyword only counts if it ends where the identifier
+// does. Both lexers start in lex state 0, which accepts every token. Reports
+// identifiers per second.
+
+#include "tree_sitter/parser.h"
+#include "mock_lexer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+static const char *words[] = {
+    // Keywords
+    "and", "as", "break", "continue", "do", "elif", "else", "extern", "fn", "for", "if",
+    "impl", "import", "in", "is", "let", "loop", "match", "not", "or", "prim", "return",
+    "row", "trait", "type", "value", "while",
+    // Identifiers, some sharing a prefix or a length with a keyword
+    "x", "i", "self", "other", "len", "vec", "str", "iter", "item", "next", "push", "pop",
+    "format", "print", "println", "result", "value1", "types", "iff", "lets", "matches",
+    "continue_", "importer", "returned", "elem", "buf", "toStr", "newBuf", "startIdx",
+    "endIdx", "charCode", "parseExpr", "parseDecl", "skipWhitespace", "a_long_identifier",
+    "Vec", "Str", "Option", "Result", "Bool", "U32", "I64", "Fn", "Map", "HashMap", "Token",
+    "Iterator", "Char", "Array", "Fnx", "Type",
+};
+
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+#define NUM_IDS 1000000
+#define LINE_WORDS 10
+#define ROUNDS 10
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static TSSymbol token_symbol(const TSLanguage *language, const char *name) {
+    for (TSSymbol symbol = 1; symbol < language->token_count; symbol++) {
+        if (strcmp(language->symbol_names[symbol], name) == 0) return symbol;
+    }
+    fprintf(stderr, "no token named %s\n", name);
+    exit(1);
+}
+
+int main(void) {
+    // Fill the buffer with pseudo-randomly chosen words, a few per line.
+    size_t cap = (size_t)NUM_IDS * 32;
+    uint8_t *input = malloc(cap);
+    uint32_t *starts = malloc(NUM_IDS * sizeof(uint32_t));
+    uint32_t *columns = malloc(NUM_IDS * sizeof(uint32_t));
+    uint32_t len = 0;
+    uint32_t column = 0;
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < NUM_IDS; i++) {
+        seed = seed * 1103515245 + 12345;
+        const char *word = words[(seed >> 16) % NUM_WORDS];
+        size_t word_len = strlen(word);
+        starts[i] = len;
+        columns[i] = column;
+        memcpy(input + len, word, word_len);
+        len += (uint32_t)word_len;
+        column += (uint32_t)word_len;
+        if (i % LINE_WORDS == LINE_WORDS - 1) {
+            input[len++] = '\n';
+            column = 0;
+        } else {
+            input[len++] = ' ';
+            column++;
+        }
+    }
+
+    const TSLanguage *language = tree_sitter_fir();
+    TSSymbol word_token = language->keyword_capture_token;
+    TSSymbol upper_id = token_symbol(language, "upper_id");
+
+    MockLexer m;
+    mock_lexer_init(&m, input, len);
+
+    unsigned keyword_count = 0;
+    double best = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        keyword_count = 0;
+        double start = now();
+        for (uint32_t i = 0; i < NUM_IDS; i++) {
+            mock_lexer_start(&m, starts[i], columns[i]);
+            if (!language->lex_fn(&m.lexer, 0)) {
+                fprintf(stderr, "lex failed at byte %u\n", starts[i]);
+                return 1;
+            }
+            TSSymbol symbol = m.lexer.result_symbol;
+            if (symbol == word_token) {
+                uint32_t end = mock_lexer_token_end(&m);
+                mock_lexer_start(&m, starts[i], columns[i]);
+                if (language->keyword_lex_fn(&m.lexer, 0) && mock_lexer_token_end(&m) == end) {
+                    symbol = m.lexer.result_symbol;
+                }
+            }
+            if (symbol != word_token && symbol != upper_id) {
+                keyword_count++;
+            }
+        }
+        double elapsed = now() - start;
+        double rate = NUM_IDS / elapsed;
+        if (rate > best) best = rate;
+    }
+
+    printf("identifiers: %d, keywords: %u\n", NUM_IDS, keyword_count);
+    printf("best of %d rounds: %.1f M identifiers/s\n", ROUNDS, best / 1e6);
+
+    free(columns);
+    free(starts);
+    free(input);
+    return 0;
+}
@@ -0,0 +1,190 @@
+// Memory use of a parse.
+//
+// Usage: bench/build/memory [--json] [PATH]
+//
+// Installs counting allocators with `ts_set_allocator`, and parses each `.fir`
+// file under PATH (default: ../fir) once with a reused parser. Reports:
+//
+// - the bytes and allocations of a scanner, from
+//   `tree_sitter_fir_external_scanner_create`
+// - the allocations made during the parses
+// - the size of the trees (what is freed by `ts_tree_delete`), per source byte
+//   and per node
+// - the peak memory during a parse, above what was allocated before it, for
+//   the largest peak and per source byte over all files
+//
+// build.sh compiles the scanner for this benchmark with
+// TREE_SITTER_REUSE_ALLOCATOR, so that its allocations go through the runtime's
+// allocator and are counted too. With --json, prints a single JSON object
+// instead, for tracking memory over time.
+
+#include "corpus.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const TSLanguage *tree_sitter_fir(void);
+void *tree_sitter_fir_external_scanner_create(void);
+void tree_sitter_fir_external_scanner_destroy(void *payload);
+
+// ==================== Counting allocator ====================
+//
+// Each block is prefixed with its size, so that frees can be counted.
+
+#define HEADER_SIZE alignof(max_align_t)
+
+typedef struct {
+    uint64_t allocations;
+    uint64_t current;
+    uint64_t peak;
+} Counters;
+
+static Counters counters;
+
+static void *track(char *block, size_t size) {
+    if (block == NULL) return NULL;
+    *(size_t *)block = size;
+    counters.allocations++;
+    counters.current += size;
+    if (counters.current > counters.peak) counters.peak = counters.current;
+    return block + HEADER_SIZE;
+}
+
+static size_t untrack(void *ptr) {
+    size_t size = *(size_t *)((char *)ptr - HEADER_SIZE);
+    counters.current -= size;
+    return size;
+}
+
+static void *counting_malloc(size_t size) {
+    return track(malloc(HEADER_SIZE + size), size);
+}
+
+static void *counting_calloc(size_t count, size_t size) {
+    return track(calloc(1, HEADER_SIZE + count * size), count * size);
+}
+
+static void *counting_realloc(void *ptr, size_t size) {
+    if (ptr == NULL) return counting_malloc(size);
+    size_t old_size = untrack(ptr);
+    char *block = realloc((char *)ptr - HEADER_SIZE, HEADER_SIZE + size);
+    if (block == NULL) {
+        counters.current += old_size;
+        return NULL;
+    }
+    return track(block, size);
+}
+
+static void counting_free(void *ptr) {
+    if (ptr == NULL) return;
+    untrack(ptr);
+    free((char *)ptr - HEADER_SIZE);
+}
+
+// ==================== Benchmark ====================
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--json] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    ts_set_allocator(counting_malloc, counting_calloc, counting_realloc, counting_free);
+
+    // The scanner on its own
+    Counters before = counters;
+    void *scanner = tree_sitter_fir_external_scanner_create();
+    uint64_t scanner_bytes = counters.current - before.current;
+    uint64_t scanner_allocations = counters.allocations - before.allocations;
+    tree_sitter_fir_external_scanner_destroy(scanner);
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+
+    uint64_t parse_allocations = 0;
+    uint64_t tree_bytes = 0;
+    uint64_t nodes = 0;
+    uint64_t peak_sum = 0;
+    uint64_t peak_max = 0;
+    const char *peak_max_path = NULL;
+
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const CorpusFile *file = &corpus.files[i];
+
+        before = counters;
+        counters.peak = counters.current;
+        TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+        uint64_t peak = counters.peak - before.current;
+        parse_allocations += counters.allocations - before.allocations;
+        nodes += ts_node_descendant_count(ts_tree_root_node(tree));
+
+        uint64_t after_parse = counters.current;
+        ts_tree_delete(tree);
+        tree_bytes += after_parse - counters.current;
+
+        peak_sum += peak;
+        if (peak > peak_max) {
+            peak_max = peak;
+            peak_max_path = file->path;
+        }
+    }
+
+    double tree_per_byte = (double)tree_bytes / (double)corpus.total_bytes;
+    double tree_per_node = nodes ? (double)tree_bytes / (double)nodes : 0;
+    double peak_per_byte = (double)peak_sum / (double)corpus.total_bytes;
+    double allocations_per_kb = (double)parse_allocations / ((double)corpus.total_bytes / 1024);
+
+    if (json) {
+        printf(
+            "{\"files\": %u, \"bytes\": %llu, \"nodes\": %llu, \"scanner_bytes\": %llu, "
+            "\"scanner_allocations\": %llu, \"parse_allocations\": %llu, \"allocations_per_kb\": %.2f, "
+            "\"tree_bytes\": %llu, \"tree_bytes_per_byte\": %.3f, \"tree_bytes_per_node\": %.3f, "
+            "\"peak_max_bytes\": %llu, \"peak_bytes_per_byte\": %.3f}\n",
+            corpus.count, (unsigned long long)corpus.total_bytes, (unsigned long long)nodes,
+            (unsigned long long)scanner_bytes, (unsigned long long)scanner_allocations,
+            (unsigned long long)parse_allocations, allocations_per_kb,
+            (unsigned long long)tree_bytes, tree_per_byte, tree_per_node,
+            (unsigned long long)peak_max, peak_per_byte
+        );
+    } else {
+        printf("files:        %u (%.2f MB), %llu nodes\n",
+               corpus.count, (double)corpus.total_bytes / 1e6, (unsigned long long)nodes);
+        printf("scanner:      %llu bytes in %llu allocations\n",
+               (unsigned long long)scanner_bytes, (unsigned long long)scanner_allocations);
+        printf("allocations:  %llu (%.1f per KB of source)\n",
+               (unsigned long long)parse_allocations, allocations_per_kb);
+        printf("trees:        %.2f MB (%.2f bytes per source byte, %.2f bytes per node)\n",
+               (double)tree_bytes / 1e6, tree_per_byte, tree_per_node);
+        printf("peak:         %.1f KB max (%s), %.2f bytes per source byte\n",
+               (double)peak_max / 1e3, peak_max_path ? peak_max_path : "-", peak_per_byte);
+    }
+
+    ts_parser_delete(parser);
+    ts_set_allocator(NULL, NULL, NULL, NULL);
+    corpus_free(&corpus);
+    return 0;
+}
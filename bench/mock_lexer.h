@@ -0,0 +1,129 @@
+// An in-memory `TSLexer` for driving the external scanner without the
+// tree-sitter runtime. Only used by the benchmarks in this directory.
+
+#ifndef FIR_MOCK_LEXER_H_
+#define FIR_MOCK_LEXER_H_
+
+#include "tree_sitter/parser.h"
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    TSLexer lexer;
+    const uint8_t *input;
+    uint32_t length;
+
+    uint32_t pos;             // byte offset of the lookahead character
+    uint32_t lookahead_size;  // size of the lookahead character in bytes
+    uint32_t column;          // column of the lookahead character, in characters
+
+    uint32_t token_start;     // moved forward by skipped characters
+    uint32_t token_end;       // set by mark_end
+    bool token_end_marked;
+    bool consumed;            // a character was advanced (not skipped) past
+} MockLexer;
+
+// Decode the UTF-8 character at `pos`. Invalid bytes decode as themselves.
+static inline void mock_lexer__decode(MockLexer *m) {
+    if (m->pos >= m->length) {
+        m->lexer.lookahead = 0;
+        m->lookahead_size = 0;
+        return;
+    }
+    uint8_t c = m->input[m->pos];
+    uint32_t size = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+    if (m->pos + size > m->length) size = 1;
+    int32_t cp = size == 1 ? c : size == 2 ? (c & 0x1F) : size == 3 ? (c & 0x0F) : (c & 0x07);
+    for (uint32_t i = 1; i < size; i++) {
+        cp = (cp << 6) | (m->input[m->pos + i] & 0x3F);
+    }
+    m->lexer.lookahead = cp;
+    m->lookahead_size = size;
+}
+
+static void mock_lexer__advance(TSLexer *lexer, bool skip) {
+    MockLexer *m = (MockLexer *)lexer;
+    if (m->pos >= m->length) return;
+    if (m->lexer.lookahead == '\n') {
+        m->column = 0;
+    } else {
+        m->column++;
+    }
+    m->pos += m->lookahead_size;
+    if (skip && !m->consumed) {
+        m->token_start = m->pos;
+    } else {
+        m->consumed = true;
+    }
+    mock_lexer__decode(m);
+}
+
+static void mock_lexer__mark_end(TSLexer *lexer) {
+    MockLexer *m = (MockLexer *)lexer;
+    m->token_end = m->pos;
+    m->token_end_marked = true;
+}
+
+static uint32_t mock_lexer__get_column(TSLexer *lexer) {
+    return ((MockLexer *)lexer)->column;
+}
+
+static bool mock_lexer__is_at_included_range_start(const TSLexer *lexer) {
+    (void)lexer;
+    return false;
+}
+
+static bool mock_lexer__eof(const TSLexer *lexer) {
+    const MockLexer *m = (const MockLexer *)lexer;
+    return m->pos >= m->length;
+}
+
+static void mock_lexer__log(const TSLexer *lexer, const char *format, ...) {
+    (void)lexer;
+    (void)format;
+}
+
+static inline void mock_lexer_init(MockLexer *m, const uint8_t *input, uint32_t length) {
+    memset(m, 0, sizeof(*m));
+    m->lexer.advance = mock_lexer__advance;
+    m->lexer.mark_end = mock_lexer__mark_end;
+    m->lexer.get_column = mock_lexer__get_column;
+    m->lexer.is_at_included_range_start = mock_lexer__is_at_included_range_start;
+    m->lexer.eof = mock_lexer__eof;
+    m->lexer.log = mock_lexer__log;
+    m->input = input;
+    m->length = length;
+    mock_lexer__decode(m);
+}
+
+// Start a new token at byte offset `pos`, which is at column `column`.
+static inline void mock_lexer_start(MockLexer *m, uint32_t pos, uint32_t column) {
+    m->pos = pos;
+    m->column = column;
+    m->token_start = pos;
+    m->token_end = pos;
+    m->token_end_marked = false;
+    m->consumed = false;
+    m->lexer.result_symbol = 0;
+    mock_lexer__decode(m);
+}
+
+// Column of byte offset `pos`, in characters.
+static inline uint32_t mock_lexer_column_at(const MockLexer *m, uint32_t pos) {
+    uint32_t column = 0;
+    while (pos > 0 && m->input[pos - 1] != '\n') {
+        pos--;
+        // Don't count UTF-8 continuation bytes.
+        if ((m->input[pos] & 0xC0) != 0x80) column++;
+    }
+    return column;
+}
+
+// End of the token produced by the last scan: the `mark_end` position, or the
+// current position if `mark_end` wasn't called.
+static inline uint32_t mock_lexer_token_end(const MockLexer *m) {
+    return m->token_end_marked ? m->token_end : m->pos;
+}
+
+#endif // FIR_MOCK_LEXER_H_
@@ -0,0 +1,275 @@
+// Outline benchmark.
+//
+// Usage: bench/build/outline [-n ITERATIONS] [-q QUERY] [-v] [--json] [PATH]
+//
+// Parses all `.fir` files under PATH (default: ../fir) once, then extracts
+// the outline of each tree ITERATIONS times (default: 10) with `fir_outline`.
+// With -q (e.g. -q queries/tags.scm) it also runs the query over each tree
+// and counts its @definition captures, the other way an indexer gets the
+// declarations of a file, for comparison. Parsing isn't included.
+//
+// Reports the outline entries by kind and the time per file (mean,
+// percentiles and the slowest file). -v prints the time and entry count of
+// every file. With --json, prints a single JSON object instead.
+
+#include "corpus.h"
+#include "fir_outline.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+#define KIND_COUNT (FIR_OUTLINE_ASSOCIATED_TYPE + 1)
+
+static const char *const kind_names[KIND_COUNT] = {
+    [FIR_OUTLINE_FUNCTION] = "function",
+    [FIR_OUTLINE_TYPE] = "type",
+    [FIR_OUTLINE_CONSTRUCTOR] = "constructor",
+    [FIR_OUTLINE_TRAIT] = "trait",
+    [FIR_OUTLINE_IMPL] = "impl",
+    [FIR_OUTLINE_METHOD] = "method",
+    [FIR_OUTLINE_ASSOCIATED_TYPE] = "associated_type",
+};
+
+typedef struct {
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double max_us;
+    uint32_t slowest;
+} Times;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// `samples` must be sorted.
+static double percentile(const double *samples, size_t count, double p) {
+    if (count == 0) return 0;
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return samples[index];
+}
+
+static Times summarize(const double *times, uint32_t count) {
+    Times result = {0};
+    double *sorted = malloc(count * sizeof(double));
+    double sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += times[i];
+        if (times[i] > times[result.slowest]) result.slowest = i;
+    }
+    memcpy(sorted, times, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_doubles);
+    result.mean_us = sum / count * 1e6;
+    result.p50_us = percentile(sorted, count, 0.50) * 1e6;
+    result.p99_us = percentile(sorted, count, 0.99) * 1e6;
+    result.max_us = sorted[count - 1] * 1e6;
+    free(sorted);
+    return result;
+}
+
+// The outline of `tree`, growing the buffer when it's too small. Like an
+// indexer, the buffer is reused across files.
+static uint32_t outline(const TSTree *tree, FirOutlineEntry **entries, uint32_t *capacity) {
+    uint32_t count = fir_outline(tree, *entries, *capacity);
+    if (count > *capacity) {
+        *capacity = count * 2;
+        *entries = realloc(*entries, *capacity * sizeof(FirOutlineEntry));
+        count = fir_outline(tree, *entries, *capacity);
+    }
+    return count;
+}
+
+static uint32_t count_definitions(const TSQuery *query, TSQueryCursor *cursor, const bool *is_definition,
+                                  const TSTree *tree) {
+    uint32_t count = 0;
+    ts_query_cursor_exec(cursor, query, ts_tree_root_node(tree));
+    TSQueryMatch match;
+    uint32_t capture_index;
+    while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
+        if (is_definition[match.captures[capture_index].index]) count++;
+    }
+    return count;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ITERATIONS] [-q QUERY] [-v] [--json] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    const char *query_path = NULL;
+    int iterations = 10;
+    bool verbose = false;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            query_path = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (iterations < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const TSLanguage *language = tree_sitter_fir();
+
+    char *query_source = NULL;
+    TSQuery *query = NULL;
+    TSQueryCursor *query_cursor = NULL;
+    bool *is_definition = NULL;
+    if (query_path != NULL) {
+        uint32_t query_length;
+        if (!corpus_read_file(query_path, &query_source, &query_length)) {
+            fprintf(stderr, "error: can't read %s\n", query_path);
+            return 1;
+        }
+        uint32_t error_offset;
+        TSQueryError error_type;
+        query = ts_query_new(language, query_source, query_length, &error_offset, &error_type);
+        if (query == NULL) {
+            fprintf(stderr, "error: %s: error %d at byte %u\n", query_path, error_type, error_offset);
+            return 1;
+        }
+        uint32_t capture_count = ts_query_capture_count(query);
+        is_definition = calloc(capture_count ? capture_count : 1, sizeof(bool));
+        for (uint32_t i = 0; i < capture_count; i++) {
+            uint32_t length;
+            const char *name = ts_query_capture_name_for_id(query, i, &length);
+            is_definition[i] = length > 11 && memcmp(name, "definition.", 11) == 0;
+        }
+        query_cursor = ts_query_cursor_new();
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, language);
+    uint32_t capacity = 256;
+    FirOutlineEntry *entries = malloc(capacity * sizeof(FirOutlineEntry));
+
+    // Best time of each file, over the iterations.
+    double *outline_times = malloc(corpus.count * sizeof(double));
+    double *query_times = malloc(corpus.count * sizeof(double));
+    uint64_t kind_counts[KIND_COUNT] = {0};
+    uint64_t entry_count = 0, definition_count = 0;
+    double total_time = 0;
+
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const CorpusFile *file = &corpus.files[i];
+        TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+        uint32_t count = 0;
+        double best = 0;
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            double start = now();
+            count = outline(tree, &entries, &capacity);
+            double elapsed = now() - start;
+            total_time += elapsed;
+            if (iteration == 0 || elapsed < best) best = elapsed;
+        }
+        outline_times[i] = best;
+        entry_count += count;
+        for (uint32_t j = 0; j < count; j++) {
+            if (entries[j].kind < KIND_COUNT) kind_counts[entries[j].kind]++;
+        }
+
+        if (query != NULL) {
+            uint32_t definitions = 0;
+            best = 0;
+            for (int iteration = 0; iteration < iterations; iteration++) {
+                double start = now();
+                definitions = count_definitions(query, query_cursor, is_definition, tree);
+                double elapsed = now() - start;
+                if (iteration == 0 || elapsed < best) best = elapsed;
+            }
+            query_times[i] = best;
+            definition_count += definitions;
+        }
+
+        if (verbose && !json) {
+            printf("%10.1f us %6u entries", outline_times[i] * 1e6, count);
+            if (query != NULL) printf("  query %10.1f us", query_times[i] * 1e6);
+            printf("  %s\n", file->path);
+        }
+        ts_tree_delete(tree);
+    }
+
+    Times times = summarize(outline_times, corpus.count);
+    double mb_per_s = (double)corpus.total_bytes * iterations / total_time / 1e6;
+    Times query_summary = {0};
+    if (query != NULL) query_summary = summarize(query_times, corpus.count);
+
+    if (json) {
+        printf("{\"files\": %u, \"bytes\": %llu, \"iterations\": %d, \"entries\": %llu, \"kinds\": {",
+               corpus.count, (unsigned long long)corpus.total_bytes, iterations, (unsigned long long)entry_count);
+        for (int kind = 0; kind < KIND_COUNT; kind++) {
+            printf("%s\"%s\": %llu", kind ? ", " : "", kind_names[kind], (unsigned long long)kind_counts[kind]);
+        }
+        printf("}, \"mb_per_s\": %.3f, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f",
+               mb_per_s, times.mean_us, times.p50_us, times.p99_us, times.max_us);
+        if (query != NULL) {
+            printf(", \"query\": {\"path\": \"%s\", \"definitions\": %llu, \"mean_us\": %.3f, \"p50_us\": %.3f, "
+                   "\"p99_us\": %.3f, \"max_us\": %.3f}",
+                   query_path, (unsigned long long)definition_count, query_summary.mean_us, query_summary.p50_us,
+                   query_summary.p99_us, query_summary.max_us);
+        }
+        printf("}\n");
+    } else {
+        printf("files:       %u (%.2f MB), %d iterations\n",
+               corpus.count, (double)corpus.total_bytes / 1e6, iterations);
+        printf("entries:     %llu (%.1f per file)\n", (unsigned long long)entry_count,
+               (double)entry_count / corpus.count);
+        for (int kind = 0; kind < KIND_COUNT; kind++) {
+            printf("  %-16s %llu\n", kind_names[kind], (unsigned long long)kind_counts[kind]);
+        }
+        printf("per file:    mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (%s)\n",
+               times.mean_us, times.p50_us, times.p99_us, times.max_us, corpus.files[times.slowest].path);
+        printf("throughput:  %.2f MB/s\n", mb_per_s);
+        if (query != NULL) {
+            printf("%s: %llu definitions, per file mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (%s)\n",
+                   query_path, (unsigned long long)definition_count, query_summary.mean_us, query_summary.p50_us,
+                   query_summary.p99_us, query_summary.max_us, corpus.files[query_summary.slowest].path);
+        }
+    }
+
+    free(entries);
+    free(query_times);
+    free(outline_times);
+    ts_parser_delete(parser);
+    if (query != NULL) {
+        ts_query_cursor_delete(query_cursor);
+        ts_query_delete(query);
+        free(is_definition);
+        free(query_source);
+    }
+    corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Parallel single-file parse benchmark.
+//
+// Usage: bench/build/parallel [-n ITERATIONS] [-j JOBS] [-c BYTES] [--json] [PATH]
+//
+// Parses each `.fir` file under PATH (default: ../fir) ITERATIONS times
+// (default: 10) with one parser, and with `fir_parse_parallel`
+// (lib/fir_parallel.h) on JOBS threads (default: number of CPUs) with chunks of
+// at least BYTES (default: 64 KB). Reports the best time of each for the total
+// of all files and the speedup, and the number of chunks and chunks with
+// errors. Use it on large files: smaller files are parsed as one chunk. With
+// --json, prints a single JSON object instead.
+
+#include "corpus.h"
+#include "fir_parallel.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ITERATIONS] [-j JOBS] [-c BYTES] [--json] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    int iterations = 10;
+    int jobs = 0;
+    int chunk_bytes = 0;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            chunk_bytes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (iterations < 1 || jobs < 0 || chunk_bytes < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    const TSLanguage *language = tree_sitter_fir();
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, language);
+
+    double serial_time = 0, parallel_time = 0;
+    uint64_t chunks_total = 0, error_chunks = 0;
+    uint32_t error_files = 0;
+
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const CorpusFile *file = &corpus.files[i];
+        double best_serial = 0, best_parallel = 0;
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            double start = now();
+            TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+            double elapsed = now() - start;
+            if (iteration == 0 || elapsed < best_serial) best_serial = elapsed;
+            if (iteration == 0 && ts_node_has_error(ts_tree_root_node(tree))) error_files++;
+            ts_tree_delete(tree);
+
+            FirChunk *chunks;
+            start = now();
+            uint32_t count = fir_parse_parallel(language, file->source, file->length, (uint32_t)jobs,
+                                                (uint32_t)chunk_bytes, &chunks);
+            elapsed = now() - start;
+            if (iteration == 0 || elapsed < best_parallel) best_parallel = elapsed;
+            if (iteration == 0) {
+                chunks_total += count;
+                for (uint32_t c = 0; c < count; c++) {
+                    if (ts_node_has_error(ts_tree_root_node(chunks[c].tree))) error_chunks++;
+                }
+            }
+            fir_chunks_delete(chunks, count);
+        }
+        serial_time += best_serial;
+        parallel_time += best_parallel;
+    }
+
+    double speedup = serial_time / parallel_time;
+
+    if (json) {
+        printf(
+            "{\"files\": %u, \"bytes\": %llu, \"iterations\": %d, \"serial_ms\": %.4f, \"parallel_ms\": %.4f, "
+            "\"speedup\": %.3f, \"chunks\": %llu, \"error_chunks\": %llu, \"error_files\": %u}\n",
+            corpus.count, (unsigned long long)corpus.total_bytes, iterations, serial_time * 1e3,
+            parallel_time * 1e3, speedup, (unsigned long long)chunks_total,
+            (unsigned long long)error_chunks, error_files
+        );
+    } else {
+        printf("files:       %u (%.2f MB), best of %d iterations\n",
+               corpus.count, (double)corpus.total_bytes / 1e6, iterations);
+        printf("serial:      %.3f ms\n", serial_time * 1e3);
+        printf("parallel:    %.3f ms (%.2fx)\n", parallel_time * 1e3, speedup);
+        printf("chunks:      %llu (%llu with errors)\n",
+               (unsigned long long)chunks_total, (unsigned long long)error_chunks);
+        printf("with errors: %u files\n", error_files);
+    }
+
+    ts_parser_delete(parser);
+    corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,240 @@
+// In-process parse throughput benchmark.
+//
+// Usage: bench/build/parse [-n ITERATIONS] [-g] [--json] [PATH]
+//
+// Loads all `.fir` files under PATH (default: ../fir) once, then parses each
+// file ITERATIONS times (default: 10) with a single reused parser. Reports
+// throughput, per-file parse latency percentiles, node count and peak memory.
+// With --json, prints a single JSON object instead, for tracking results over
+// time.
+//
+// With -g, also parses each file once more with a logger that counts GLR
+// stack versions: the most versions at once, and the number of version steps
+// (each step of the parse processes every version; without forking, there is
+// one version per step). Prints the totals and the files with the most
+// versions. Logging makes this parse slow, so it isn't timed.
+//
+// When the grammar is built with FIR_SCANNER_STATS (e.g.
+// `CFLAGS="-O2 -DFIR_SCANNER_STATS" bench/build.sh`), also prints the scanner
+// counters for all iterations to stderr.
+
+#include "corpus.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+#ifdef FIR_SCANNER_STATS
+void fir_scanner_stats_reset(void);
+void fir_scanner_stats_print(FILE *out);
+#endif
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// `samples` must be sorted.
+static double percentile(const double *samples, size_t count, double p) {
+    if (count == 0) return 0;
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return samples[index];
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// GLR stack versions of one parse, from the parser's "process version" log
+// messages.
+typedef struct {
+    uint32_t max_versions;
+    uint64_t steps;         // one per version per step
+    uint64_t forked_steps;  // of those, while there was more than one version
+} VersionCounts;
+
+typedef struct {
+    const CorpusFile *file;
+    VersionCounts counts;
+} FileVersions;
+
+static void count_versions(void *payload, TSLogType type, const char *message) {
+    if (type != TSLogTypeParse || strncmp(message, "process version:", 16) != 0) return;
+    unsigned version, count;
+    if (sscanf(message, "process version:%u, version_count:%u", &version, &count) != 2) return;
+    VersionCounts *counts = payload;
+    counts->steps++;
+    if (count > 1) counts->forked_steps++;
+    if (count > counts->max_versions) counts->max_versions = count;
+}
+
+// Most forked steps first.
+static int compare_file_versions(const void *a, const void *b) {
+    const FileVersions *x = a, *y = b;
+    if (x->counts.forked_steps != y->counts.forked_steps) {
+        return x->counts.forked_steps > y->counts.forked_steps ? -1 : 1;
+    }
+    return 0;
+}
+
+#define TOP_FORKED_FILES 10
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ITERATIONS] [-g] [--json] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    int iterations = 10;
+    bool json = false;
+    bool versions = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0) {
+            versions = true;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (iterations < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+
+    size_t sample_count = (size_t)corpus.count * (size_t)iterations;
+    double *samples = malloc(sample_count * sizeof(double));
+    size_t num_samples = 0;
+    uint64_t nodes = 0;
+    uint32_t error_files = 0;
+    double total_time = 0;
+
+#ifdef FIR_SCANNER_STATS
+    fir_scanner_stats_reset();
+#endif
+
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const CorpusFile *file = &corpus.files[i];
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            double start = now();
+            TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+            double elapsed = now() - start;
+            total_time += elapsed;
+            samples[num_samples++] = elapsed;
+
+            if (iteration == 0) {
+                TSNode root = ts_tree_root_node(tree);
+                nodes += ts_node_descendant_count(root);
+                if (ts_node_has_error(root)) error_files++;
+            }
+            ts_tree_delete(tree);
+        }
+    }
+
+    FileVersions *file_versions = NULL;
+    VersionCounts total_versions = {0};
+    if (versions) {
+        file_versions = calloc(corpus.count, sizeof(FileVersions));
+        for (uint32_t i = 0; i < corpus.count; i++) {
+            FileVersions *entry = &file_versions[i];
+            entry->file = &corpus.files[i];
+            ts_parser_set_logger(parser, (TSLogger){&entry->counts, count_versions});
+            ts_tree_delete(ts_parser_parse_string(parser, NULL, entry->file->source, entry->file->length));
+            total_versions.steps += entry->counts.steps;
+            total_versions.forked_steps += entry->counts.forked_steps;
+            if (entry->counts.max_versions > total_versions.max_versions) {
+                total_versions.max_versions = entry->counts.max_versions;
+            }
+        }
+        ts_parser_set_logger(parser, (TSLogger){NULL, NULL});
+        qsort(file_versions, corpus.count, sizeof(FileVersions), compare_file_versions);
+    }
+
+    qsort(samples, num_samples, sizeof(double), compare_doubles);
+    double mb_per_s = (double)corpus.total_bytes * iterations / total_time / 1e6;
+    double p50_ms = percentile(samples, num_samples, 0.50) * 1e3;
+    double p99_ms = percentile(samples, num_samples, 0.99) * 1e3;
+    double max_ms = samples[num_samples - 1] * 1e3;
+    long rss_kb = peak_rss_kb();
+
+    if (json) {
+        printf(
+            "{\"files\": %u, \"bytes\": %llu, \"iterations\": %d, \"seconds\": %.6f, "
+            "\"mb_per_s\": %.3f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, "
+            "\"nodes\": %llu, \"error_files\": %u, \"peak_rss_kb\": %ld",
+            corpus.count, (unsigned long long)corpus.total_bytes, iterations, total_time,
+            mb_per_s, p50_ms, p99_ms, max_ms,
+            (unsigned long long)nodes, error_files, rss_kb
+        );
+        if (versions) {
+            printf(", \"max_versions\": %u, \"version_steps\": %llu, \"forked_steps\": %llu",
+                   total_versions.max_versions, (unsigned long long)total_versions.steps,
+                   (unsigned long long)total_versions.forked_steps);
+        }
+        printf("}\n");
+    } else {
+        printf("files:       %u (%.2f MB), %d iterations\n",
+               corpus.count, (double)corpus.total_bytes / 1e6, iterations);
+        printf("throughput:  %.2f MB/s\n", mb_per_s);
+        printf("latency:     p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", p50_ms, p99_ms, max_ms);
+        printf("nodes:       %llu\n", (unsigned long long)nodes);
+        printf("with errors: %u files\n", error_files);
+        printf("peak RSS:    %ld KB\n", rss_kb);
+        if (versions) {
+            double forked = total_versions.steps
+                ? 100.0 * (double)total_versions.forked_steps / (double)total_versions.steps : 0;
+            printf("GLR:         max %u versions, %llu version steps, %.2f%% while forked\n",
+                   total_versions.max_versions, (unsigned long long)total_versions.steps, forked);
+            for (uint32_t i = 0; i < corpus.count && i < TOP_FORKED_FILES; i++) {
+                const FileVersions *entry = &file_versions[i];
+                if (entry->counts.forked_steps == 0) break;
+                printf("  %8llu forked of %8llu steps, max %3u versions  %s\n",
+                       (unsigned long long)entry->counts.forked_steps, (unsigned long long)entry->counts.steps,
+                       entry->counts.max_versions, entry->file->path);
+            }
+        }
+    }
+
+#ifdef FIR_SCANNER_STATS
+    fir_scanner_stats_print(stderr);
+#endif
+
+    free(file_versions);
+    free(samples);
+    ts_parser_delete(parser);
+    corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,229 @@
+// Query execution benchmark.
+//
+// Usage: bench/build/query [-n ITERATIONS] [-p] [--json] QUERY [PATH]
+//
+// Parses all `.fir` files under PATH (default: ../fir) once, then runs the
+// query in the QUERY file (e.g. queries/tags.scm) over each tree ITERATIONS
+// times (default: 10), iterating captures with `ts_query_cursor_next_capture`
+// like `tree-sitter tags` and `tree-sitter highlight` do. Reports query
+// throughput (parsing isn't included) and the number of captures of each
+// capture name. With -p, also runs each pattern on its own (all other patterns
+// disabled) and reports the patterns by time, with their match counts. With
+// --json, prints a single JSON object instead.
+
+#include "corpus.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    uint32_t pattern_index;
+    uint32_t line;
+    double time;
+    uint64_t matches;
+} PatternStats;
+
+// Run `query` over all trees `iterations` times and return the total time.
+// Captures and matches are counted in the first iteration. `capture_counts`
+// may be NULL.
+static double run_query(const TSQuery *query, TSQueryCursor *cursor, TSTree **trees, uint32_t tree_count,
+                        int iterations, uint64_t *capture_counts, uint64_t *matches) {
+    double total_time = 0;
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        for (uint32_t i = 0; i < tree_count; i++) {
+            double start = now();
+            ts_query_cursor_exec(cursor, query, ts_tree_root_node(trees[i]));
+            TSQueryMatch match;
+            uint32_t capture_index;
+            while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
+                if (iteration == 0) {
+                    if (capture_counts) capture_counts[match.captures[capture_index].index]++;
+                    if (capture_index == 0) (*matches)++;
+                }
+            }
+            total_time += now() - start;
+        }
+    }
+    return total_time;
+}
+
+static uint32_t line_at(const char *source, uint32_t byte) {
+    uint32_t line = 1;
+    for (uint32_t i = 0; i < byte; i++) {
+        if (source[i] == '\n') line++;
+    }
+    return line;
+}
+
+static int compare_pattern_times(const void *a, const void *b) {
+    double x = ((const PatternStats *)a)->time, y = ((const PatternStats *)b)->time;
+    return x > y ? -1 : x < y;
+}
+
+static const char *query_error_name(TSQueryError error) {
+    switch (error) {
+        case TSQueryErrorSyntax: return "syntax error";
+        case TSQueryErrorNodeType: return "invalid node type";
+        case TSQueryErrorField: return "invalid field";
+        case TSQueryErrorCapture: return "invalid capture";
+        case TSQueryErrorStructure: return "impossible pattern";
+        case TSQueryErrorLanguage: return "language mismatch";
+        default: return "error";
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ITERATIONS] [-p] [--json] QUERY [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *query_path = NULL;
+    const char *path = "../fir";
+    int iterations = 10;
+    bool json = false;
+    bool per_pattern = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            per_pattern = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else if (query_path == NULL) {
+            query_path = argv[i];
+        } else {
+            path = argv[i];
+        }
+    }
+    if (query_path == NULL || iterations < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const TSLanguage *language = tree_sitter_fir();
+
+    char *query_source;
+    uint32_t query_length;
+    if (!corpus_read_file(query_path, &query_source, &query_length)) {
+        fprintf(stderr, "error: can't read %s\n", query_path);
+        return 1;
+    }
+    uint32_t error_offset;
+    TSQueryError error_type;
+    TSQuery *query = ts_query_new(language, query_source, query_length, &error_offset, &error_type);
+    if (query == NULL) {
+        fprintf(stderr, "error: %s: %s at byte %u\n", query_path, query_error_name(error_type), error_offset);
+        return 1;
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, language);
+    TSTree **trees = malloc(corpus.count * sizeof(TSTree *));
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        trees[i] = ts_parser_parse_string(parser, NULL, corpus.files[i].source, corpus.files[i].length);
+    }
+
+    uint32_t capture_name_count = ts_query_capture_count(query);
+    uint64_t *capture_counts = calloc(capture_name_count, sizeof(uint64_t));
+    uint64_t matches = 0;
+    TSQueryCursor *cursor = ts_query_cursor_new();
+    double total_time = run_query(query, cursor, trees, corpus.count, iterations, capture_counts, &matches);
+
+    // Each pattern on its own
+    uint32_t pattern_count = ts_query_pattern_count(query);
+    PatternStats *patterns = NULL;
+    if (per_pattern) {
+        patterns = calloc(pattern_count, sizeof(PatternStats));
+        for (uint32_t p = 0; p < pattern_count; p++) {
+            TSQuery *single = ts_query_new(language, query_source, query_length, &error_offset, &error_type);
+            for (uint32_t other = 0; other < pattern_count; other++) {
+                if (other != p) ts_query_disable_pattern(single, other);
+            }
+            patterns[p].pattern_index = p;
+            patterns[p].line = line_at(query_source, ts_query_start_byte_for_pattern(query, p));
+            patterns[p].time = run_query(single, cursor, trees, corpus.count, iterations, NULL, &patterns[p].matches);
+            ts_query_delete(single);
+        }
+        qsort(patterns, pattern_count, sizeof(PatternStats), compare_pattern_times);
+    }
+
+    double mb_per_s = (double)corpus.total_bytes * iterations / total_time / 1e6;
+    double ms_per_iteration = total_time / iterations * 1e3;
+
+    if (json) {
+        printf("{\"query\": \"%s\", \"files\": %u, \"bytes\": %llu, \"iterations\": %d, \"seconds\": %.6f, "
+               "\"mb_per_s\": %.3f, \"ms_per_iteration\": %.4f, \"matches\": %llu, \"captures\": {",
+               query_path, corpus.count, (unsigned long long)corpus.total_bytes, iterations, total_time,
+               mb_per_s, ms_per_iteration, (unsigned long long)matches);
+        for (uint32_t i = 0; i < capture_name_count; i++) {
+            uint32_t length;
+            const char *name = ts_query_capture_name_for_id(query, i, &length);
+            printf("%s\"%.*s\": %llu", i ? ", " : "", (int)length, name, (unsigned long long)capture_counts[i]);
+        }
+        printf("}");
+        if (per_pattern) {
+            printf(", \"patterns\": [");
+            for (uint32_t i = 0; i < pattern_count; i++) {
+                printf("%s{\"pattern\": %u, \"line\": %u, \"ms_per_iteration\": %.4f, \"matches\": %llu}",
+                       i ? ", " : "", patterns[i].pattern_index, patterns[i].line,
+                       patterns[i].time / iterations * 1e3, (unsigned long long)patterns[i].matches);
+            }
+            printf("]");
+        }
+        printf("}\n");
+    } else {
+        printf("query:       %s (%u patterns)\n", query_path, ts_query_pattern_count(query));
+        printf("files:       %u (%.2f MB), %d iterations\n",
+               corpus.count, (double)corpus.total_bytes / 1e6, iterations);
+        printf("throughput:  %.2f MB/s, %.3f ms per iteration\n", mb_per_s, ms_per_iteration);
+        printf("matches:     %llu\n", (unsigned long long)matches);
+        printf("captures:\n");
+        for (uint32_t i = 0; i < capture_name_count; i++) {
+            uint32_t length;
+            const char *name = ts_query_capture_name_for_id(query, i, &length);
+            printf("  %-28.*s %10llu\n", (int)length, name, (unsigned long long)capture_counts[i]);
+        }
+        if (per_pattern) {
+            // The sum of the pattern times is usually more than the time of the
+            // whole query, as each run walks the trees on its own.
+            printf("patterns (ms per iteration, alone):\n");
+            for (uint32_t i = 0; i < pattern_count; i++) {
+                printf("  line %-5u %10.3f ms %10llu matches\n", patterns[i].line,
+                       patterns[i].time / iterations * 1e3, (unsigned long long)patterns[i].matches);
+            }
+        }
+    }
+
+    ts_query_cursor_delete(cursor);
+    free(patterns);
+    free(capture_counts);
+    for (uint32_t i = 0; i < corpus.count; i++) ts_tree_delete(trees[i]);
+    free(trees);
+    ts_parser_delete(parser);
+    ts_query_delete(query);
+    free(query_source);
+    corpus_free(&corpus);
+    return 0;
+}
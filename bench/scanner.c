@@ -0,0 +1,187 @@
+// Microbenchmark for the external scanner on its own, replaying the scanner
+// calls of real parses.
+//
+// Usage: bench/build/scanner [-n ROUNDS] [--json] [TRACE]
+//
+// TRACE (default: bench/build/scanner.trace) is written by
+// bench/build/scanner_record. Each call is replayed as the runtime makes it:
+// the recorded state is deserialized, the mock lexer (mock_lexer.h) is started
+// at the token's position, and `scan` is called with the recorded valid
+// tokens. Reports the time per call for all calls in their recorded order, and
+// for the calls that returned each token type, best of ROUNDS (default 10).
+// The parse tables and the runtime's lexer aren't involved, so the times are
+// the scanner's alone.
+//
+// A trace can be replayed against a changed scanner as long as the externals
+// and the serialization format stay the same. Calls that return a different
+// token than when they were recorded are reported as mismatches.
+
+#define FIR_SCANNER_TOKEN_NAMES
+#include "../src/scanner.c"
+#include "mock_lexer.h"
+#include "scanner_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    const TraceFile *file;
+    const TraceCall *call;
+    const bool *valid;
+    uint32_t column;
+} Replay;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Replay one call. Returns the token, or TOKEN_COUNT if the scan failed.
+static inline uint16_t replay(void *scanner, MockLexer *m, const Replay *r) {
+    tree_sitter_fir_external_scanner_deserialize(scanner, r->file->states + r->call->state_offset,
+                                                 r->call->state_length);
+    m->input = (const uint8_t *)r->file->source;
+    m->length = r->file->length;
+    mock_lexer_start(m, r->call->byte, r->column);
+    if (!tree_sitter_fir_external_scanner_scan(scanner, &m->lexer, r->valid)) return TOKEN_COUNT;
+    return (uint16_t)m->lexer.result_symbol;
+}
+
+// Best time per call of replaying `replays` `rounds` times.
+static double time_replays(void *scanner, MockLexer *m, const Replay *const *replays, uint32_t count,
+                           int rounds) {
+    double best = 0;
+    for (int round = 0; round < rounds; round++) {
+        double start = now();
+        for (uint32_t i = 0; i < count; i++) replay(scanner, m, replays[i]);
+        double per_call = (now() - start) / count;
+        if (round == 0 || per_call < best) best = per_call;
+    }
+    return best;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ROUNDS] [--json] [TRACE]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "bench/build/scanner.trace";
+    int rounds = 10;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (rounds < 1) rounds = 1;
+
+    Trace trace;
+    if (!trace_read(&trace, path)) {
+        fprintf(stderr, "error: can't read trace %s (record one with bench/build/scanner_record)\n", path);
+        return 1;
+    }
+    if (trace.token_count != TOKEN_COUNT) {
+        fprintf(stderr, "error: %s was recorded with %u tokens, the scanner has %d\n", path,
+                trace.token_count, TOKEN_COUNT);
+        return 1;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < trace.file_count; i++) count += trace.files[i].call_count;
+    if (count == 0) {
+        fprintf(stderr, "error: no calls in %s\n", path);
+        return 1;
+    }
+
+    // Columns are computed up front, as the runtime tracks them as it goes.
+    Replay *replays = malloc(count * sizeof(Replay));
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < trace.file_count; i++) {
+        const TraceFile *file = &trace.files[i];
+        MockLexer m;
+        mock_lexer_init(&m, (const uint8_t *)file->source, file->length);
+        for (uint32_t c = 0; c < file->call_count; c++) {
+            const TraceCall *call = &file->calls[c];
+            replays[n++] = (Replay){
+                file, call, &trace.valid_sets[(size_t)call->valid_set * TOKEN_COUNT],
+                mock_lexer_column_at(&m, call->byte),
+            };
+        }
+    }
+
+    void *scanner = tree_sitter_fir_external_scanner_create();
+    MockLexer m;
+    mock_lexer_init(&m, NULL, 0);
+
+    // One pass to check the results, and group the calls by recorded token.
+    // The last group is for failed scans.
+    uint32_t mismatches = 0;
+    uint32_t group_sizes[TOKEN_COUNT + 1] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+        if (replay(scanner, &m, &replays[i]) != replays[i].call->result) mismatches++;
+        group_sizes[replays[i].call->result]++;
+    }
+    const Replay **ordered = malloc(count * sizeof(Replay *));
+    const Replay **grouped = malloc(count * sizeof(Replay *));
+    uint32_t group_starts[TOKEN_COUNT + 1];
+    uint32_t offset = 0;
+    for (int t = 0; t <= TOKEN_COUNT; t++) {
+        group_starts[t] = offset;
+        offset += group_sizes[t];
+    }
+    uint32_t group_fill[TOKEN_COUNT + 1] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t t = replays[i].call->result;
+        ordered[i] = &replays[i];
+        grouped[group_starts[t] + group_fill[t]++] = &replays[i];
+    }
+
+    double all = time_replays(scanner, &m, ordered, count, rounds);
+    double by_token[TOKEN_COUNT + 1] = {0};
+    for (int t = 0; t <= TOKEN_COUNT; t++) {
+        if (group_sizes[t] == 0) continue;
+        by_token[t] = time_replays(scanner, &m, grouped + group_starts[t], group_sizes[t], rounds);
+    }
+
+    if (json) {
+        printf("{\"files\": %u, \"calls\": %u, \"mismatches\": %u, \"ns_per_call\": %.2f, \"tokens\": {",
+               trace.file_count, count, mismatches, all * 1e9);
+        bool first = true;
+        for (int t = 0; t <= TOKEN_COUNT; t++) {
+            if (group_sizes[t] == 0) continue;
+            printf("%s\"%s\": {\"calls\": %u, \"ns_per_call\": %.2f}", first ? "" : ", ",
+                   t == TOKEN_COUNT ? "failed" : token_names[t], group_sizes[t], by_token[t] * 1e9);
+            first = false;
+        }
+        printf("}}\n");
+    } else {
+        printf("calls:       %u in %u files, %u mismatches\n", count, trace.file_count, mismatches);
+        printf("all:         %.1f ns/call (best of %d rounds)\n", all * 1e9, rounds);
+        printf("%-20s %10s %10s\n", "token", "calls", "ns/call");
+        for (int t = 0; t <= TOKEN_COUNT; t++) {
+            if (group_sizes[t] == 0) continue;
+            printf("%-20s %10u %10.1f\n", t == TOKEN_COUNT ? "(failed)" : token_names[t], group_sizes[t],
+                   by_token[t] * 1e9);
+        }
+    }
+    if (mismatches > 0) {
+        fprintf(stderr, "warning: %u calls returned a different token than when recorded\n", mismatches);
+    }
+
+    tree_sitter_fir_external_scanner_destroy(scanner);
+    free(grouped);
+    free(ordered);
+    free(replays);
+    trace_free(&trace);
+    return 0;
+}
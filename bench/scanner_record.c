@@ -0,0 +1,211 @@
+// Records the external scanner calls of real parses, for bench/scanner.c.
+//
+// Usage: bench/build/scanner_record [-o TRACE] [PATH]
+//
+// Parses each `.fir` file under PATH (default: ../fir) and records every call
+// to the external scanner: the position of the token, the serialized scanner
+// state the runtime passed in, the valid tokens and the token returned. The
+// trace (default: bench/build/scanner.trace) has the sources too, so that the
+// replay doesn't need the files or the runtime.
+//
+// The scanner is compiled into this program with its `scan` wrapped. The
+// runtime doesn't pass the position to the scanner, so it is taken from the
+// parser's `lex_external` log message, which comes right before each call.
+
+#include "corpus.h"
+#include "scanner_trace.h"
+
+#include <tree_sitter/api.h>
+
+#define tree_sitter_fir_external_scanner_scan fir_scanner_scan
+#include "../src/scanner.c"
+#undef tree_sitter_fir_external_scanner_scan
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const TSLanguage *tree_sitter_fir(void);
+bool tree_sitter_fir_external_scanner_scan(void *payload, TSLexer *lexer, const bool *valid);
+
+typedef struct {
+    Trace trace;
+    uint32_t valid_set_capacity;
+    int32_t *valid_set_for_state;  // by external lex state, -1 if not seen yet
+    uint32_t state_capacity;
+
+    // The file being parsed
+    TraceFile *file;
+    uint32_t call_capacity;
+    uint32_t states_capacity;
+    uint32_t *line_starts;
+    uint32_t line_count;
+
+    // From the last `lex_external` message
+    bool pending;
+    uint32_t pending_byte;
+    uint32_t pending_state;
+
+    uint64_t unpositioned;  // calls without a log message before them
+} Recorder;
+
+static Recorder recorder;
+
+static uint16_t valid_set_for(Recorder *r, uint32_t lex_state, const bool *valid) {
+    if (lex_state >= r->state_capacity) {
+        uint32_t capacity = r->state_capacity ? r->state_capacity : 64;
+        while (capacity <= lex_state) capacity *= 2;
+        r->valid_set_for_state = realloc(r->valid_set_for_state, capacity * sizeof(int32_t));
+        for (uint32_t i = r->state_capacity; i < capacity; i++) r->valid_set_for_state[i] = -1;
+        r->state_capacity = capacity;
+    }
+    if (r->valid_set_for_state[lex_state] < 0) {
+        Trace *trace = &r->trace;
+        if (trace->valid_set_count == r->valid_set_capacity) {
+            r->valid_set_capacity = r->valid_set_capacity ? r->valid_set_capacity * 2 : 64;
+            trace->valid_sets = realloc(trace->valid_sets, (size_t)r->valid_set_capacity * TOKEN_COUNT);
+        }
+        bool *set = &trace->valid_sets[(size_t)trace->valid_set_count * TOKEN_COUNT];
+        memcpy(set, valid, TOKEN_COUNT);
+        r->valid_set_for_state[lex_state] = (int32_t)trace->valid_set_count++;
+    }
+    return (uint16_t)r->valid_set_for_state[lex_state];
+}
+
+static void log_message(void *payload, TSLogType type, const char *message) {
+    (void)type;
+    Recorder *r = payload;
+    if (strncmp(message, "lex_external", 12) != 0) return;
+    unsigned state, row, column;
+    if (sscanf(message, "lex_external state:%u, row:%u, column:%u", &state, &row, &column) != 3) return;
+    if (row >= r->line_count) return;
+    r->pending = true;
+    r->pending_byte = r->line_starts[row] + column;  // TSPoint columns are in bytes
+    r->pending_state = state;
+}
+
+bool tree_sitter_fir_external_scanner_scan(void *payload, TSLexer *lexer, const bool *valid) {
+    Recorder *r = &recorder;
+    if (!r->pending) {
+        r->unpositioned++;
+        return fir_scanner_scan(payload, lexer, valid);
+    }
+    r->pending = false;
+
+    TraceFile *file = r->file;
+    char state[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+    unsigned state_length = tree_sitter_fir_external_scanner_serialize(payload, state);
+    if (file->states_length + state_length > r->states_capacity) {
+        while (file->states_length + state_length > r->states_capacity) {
+            r->states_capacity = r->states_capacity ? r->states_capacity * 2 : 4096;
+        }
+        file->states = realloc(file->states, r->states_capacity);
+    }
+    memcpy(file->states + file->states_length, state, state_length);
+
+    TraceCall call = {
+        .byte = r->pending_byte,
+        .state_offset = file->states_length,
+        .state_length = state_length,
+        .valid_set = valid_set_for(r, r->pending_state, valid),
+    };
+    file->states_length += state_length;
+
+    bool found = fir_scanner_scan(payload, lexer, valid);
+    call.result = found ? (uint16_t)lexer->result_symbol : TOKEN_COUNT;
+
+    if (file->call_count == r->call_capacity) {
+        r->call_capacity = r->call_capacity ? r->call_capacity * 2 : 1024;
+        file->calls = realloc(file->calls, r->call_capacity * sizeof(TraceCall));
+    }
+    file->calls[file->call_count++] = call;
+    return found;
+}
+
+static void start_file(Recorder *r, TraceFile *file) {
+    r->file = file;
+    r->call_capacity = 0;
+    r->states_capacity = 0;
+    r->pending = false;
+    r->line_count = 0;
+    r->line_starts = realloc(r->line_starts, ((size_t)file->length + 1) * sizeof(uint32_t));
+    r->line_starts[r->line_count++] = 0;
+    for (uint32_t i = 0; i < file->length; i++) {
+        if (file->source[i] == '\n') r->line_starts[r->line_count++] = i + 1;
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-o TRACE] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    const char *output = "bench/build/scanner.trace";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    Recorder *r = &recorder;
+    Trace *trace = &r->trace;
+    trace->token_count = TOKEN_COUNT;
+    trace->files = calloc(corpus.count, sizeof(TraceFile));
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+    ts_parser_set_logger(parser, (TSLogger){r, log_message});
+
+    uint64_t calls = 0;
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        CorpusFile *source = &corpus.files[i];
+        TraceFile *file = &trace->files[trace->file_count++];
+        // The trace takes over the path and the source.
+        file->path = source->path;
+        file->source = source->source;
+        file->length = source->length;
+        source->path = NULL;
+        source->source = NULL;
+
+        start_file(r, file);
+        TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+        ts_tree_delete(tree);
+        calls += file->call_count;
+    }
+    ts_parser_delete(parser);
+
+    if (calls == 0) {
+        fprintf(stderr, "error: no positioned scanner calls (%llu without a lex_external log message)\n",
+                (unsigned long long)r->unpositioned);
+        return 1;
+    }
+    if (r->unpositioned > 0) {
+        fprintf(stderr, "warning: %llu scanner calls without a position weren't recorded\n",
+                (unsigned long long)r->unpositioned);
+    }
+    if (!trace_write(trace, output)) {
+        perror(output);
+        return 1;
+    }
+    printf("recorded %llu scanner calls in %u files (%u valid token sets) to %s\n",
+           (unsigned long long)calls, trace->file_count, trace->valid_set_count, output);
+
+    trace_free(trace);
+    free(r->valid_set_for_state);
+    free(r->line_starts);
+    corpus_free(&corpus);
+    return 0;
+}
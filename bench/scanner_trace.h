@@ -0,0 +1,148 @@
+// Recorded external scanner calls, written by bench/scanner_record.c and
+// replayed by bench/scanner.c.
+//
+// A trace has a header, the distinct sets of valid tokens (one per external
+// lex state of the parser), and then for each file its path, its source, its
+// calls and the serialized scanner states the calls point into. The structs
+// are written as they are in memory, so a trace is only read back on the kind
+// of machine that wrote it.
+
+#ifndef FIR_SCANNER_TRACE_H_
+#define FIR_SCANNER_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC "FIRTRACE"
+#define TRACE_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t token_count;
+    uint32_t valid_set_count;
+    uint32_t file_count;
+} TraceHeader;
+
+typedef struct {
+    uint32_t byte;          // start of the token
+    uint32_t state_offset;  // the scanner state before the call, in `states`
+    uint32_t state_length;
+    uint16_t valid_set;
+    uint16_t result;        // the returned TokenType, or token_count if the scan failed
+} TraceCall;
+
+typedef struct {
+    char *path;
+    char *source;
+    uint32_t length;
+    TraceCall *calls;
+    uint32_t call_count;
+    char *states;
+    uint32_t states_length;
+} TraceFile;
+
+typedef struct {
+    uint32_t token_count;
+    bool *valid_sets;  // valid_set_count sets of token_count
+    uint32_t valid_set_count;
+    TraceFile *files;
+    uint32_t file_count;
+} Trace;
+
+static inline bool trace__write_block(FILE *f, const void *data, uint32_t length) {
+    return fwrite(&length, sizeof length, 1, f) == 1 && (length == 0 || fwrite(data, length, 1, f) == 1);
+}
+
+static inline bool trace__read_block(FILE *f, void **data, uint32_t *length) {
+    if (fread(length, sizeof *length, 1, f) != 1) return false;
+    // One more byte, so that paths and sources are NUL-terminated.
+    char *buffer = malloc((size_t)*length + 1);
+    if (*length > 0 && fread(buffer, *length, 1, f) != 1) {
+        free(buffer);
+        return false;
+    }
+    buffer[*length] = '\0';
+    *data = buffer;
+    return true;
+}
+
+static inline bool trace_write(const Trace *trace, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    TraceHeader header = {
+        .version = TRACE_VERSION,
+        .token_count = trace->token_count,
+        .valid_set_count = trace->valid_set_count,
+        .file_count = trace->file_count,
+    };
+    memcpy(header.magic, TRACE_MAGIC, 8);
+    bool ok = fwrite(&header, sizeof header, 1, f) == 1;
+    size_t valid_size = (size_t)trace->valid_set_count * trace->token_count;
+    ok = ok && (valid_size == 0 || fwrite(trace->valid_sets, valid_size, 1, f) == 1);
+    for (uint32_t i = 0; ok && i < trace->file_count; i++) {
+        const TraceFile *file = &trace->files[i];
+        ok = trace__write_block(f, file->path, (uint32_t)strlen(file->path)) &&
+             trace__write_block(f, file->source, file->length) &&
+             trace__write_block(f, file->calls, file->call_count * (uint32_t)sizeof(TraceCall)) &&
+             trace__write_block(f, file->states, file->states_length);
+    }
+    return fclose(f) == 0 && ok;
+}
+
+static inline void trace_free(Trace *trace) {
+    for (uint32_t i = 0; i < trace->file_count; i++) {
+        free(trace->files[i].path);
+        free(trace->files[i].source);
+        free(trace->files[i].calls);
+        free(trace->files[i].states);
+    }
+    free(trace->files);
+    free(trace->valid_sets);
+    *trace = (Trace){0};
+}
+
+// Read the trace at `path`. Returns false (and leaves `trace` empty) if it
+// can't be read or isn't a trace of this version.
+static inline bool trace_read(Trace *trace, const char *path) {
+    *trace = (Trace){0};
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    TraceHeader header;
+    if (fread(&header, sizeof header, 1, f) != 1 || memcmp(header.magic, TRACE_MAGIC, 8) != 0 ||
+        header.version != TRACE_VERSION) {
+        fclose(f);
+        return false;
+    }
+    trace->token_count = header.token_count;
+    trace->valid_set_count = header.valid_set_count;
+    size_t valid_size = (size_t)header.valid_set_count * header.token_count;
+    trace->valid_sets = malloc(valid_size ? valid_size : 1);
+    bool ok = valid_size == 0 || fread(trace->valid_sets, valid_size, 1, f) == 1;
+
+    trace->files = calloc(header.file_count ? header.file_count : 1, sizeof(TraceFile));
+    for (uint32_t i = 0; ok && i < header.file_count; i++) {
+        TraceFile *file = &trace->files[i];
+        uint32_t path_length, calls_size = 0;
+        trace->file_count++;
+        ok = trace__read_block(f, (void **)&file->path, &path_length) &&
+             trace__read_block(f, (void **)&file->source, &file->length) &&
+             trace__read_block(f, (void **)&file->calls, &calls_size) &&
+             trace__read_block(f, (void **)&file->states, &file->states_length);
+        file->call_count = calls_size / (uint32_t)sizeof(TraceCall);
+        for (uint32_t c = 0; ok && c < file->call_count; c++) {
+            const TraceCall *call = &file->calls[c];
+            ok = call->byte <= file->length && call->valid_set < header.valid_set_count &&
+                 call->result <= header.token_count &&
+                 call->state_offset + call->state_length <= file->states_length;
+        }
+    }
+    fclose(f);
+    if (!ok) trace_free(trace);
+    return ok;
+}
+
+#endif // FIR_SCANNER_TRACE_H_
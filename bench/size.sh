@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# Reports the size of the generated parser: state and symbol counts from
+# src/parser.c, the size of parser.c, and the size of the compiled parser.o.
+# Run after `tree-sitter generate` to track the effect of grammar changes.
+#
+# Usage: bench/size.sh [--json]
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+OUT=bench/build
+CC="${CC:-cc}"
+CFLAGS="${CFLAGS:--O2}"
+
+if [ ! -f src/parser.c ]; then
+    echo "src/parser.c not found, run tree-sitter generate first" >&2
+    exit 1
+fi
+
+mkdir -p "$OUT"
+$CC $CFLAGS -Isrc -c src/parser.c -o "$OUT/parser-size.o"
+
+define() {
+    sed -n "s/^#define $1 \([0-9]*\)$/\1/p" src/parser.c
+}
+
+STATES=$(define STATE_COUNT)
+LARGE_STATES=$(define LARGE_STATE_COUNT)
+SYMBOLS=$(define SYMBOL_COUNT)
+FIELDS=$(define FIELD_COUNT)
+SOURCE_BYTES=$(wc -c < src/parser.c)
+# text + data + bss of the object file
+OBJECT_BYTES=$(size "$OUT/parser-size.o" | awk 'NR == 2 { print $4 }')
+rm "$OUT/parser-size.o"
+
+if [ "$1" = "--json" ]; then
+    echo "{\"states\": $STATES, \"large_states\": $LARGE_STATES, \"symbols\": $SYMBOLS, \"fields\": $FIELDS, \"parser_c_bytes\": $SOURCE_BYTES, \"parser_o_bytes\": $OBJECT_BYTES}"
+else
+    echo "states:       $STATES ($LARGE_STATES large)"
+    echo "symbols:      $SYMBOLS"
+    echo "fields:       $FIELDS"
+    echo "parser.c:     $SOURCE_BYTES bytes"
+    echo "parser.o:     $OBJECT_BYTES bytes ($CFLAGS)"
+fi
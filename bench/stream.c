@@ -0,0 +1,143 @@
+// Declaration-at-a-time parse benchmark.
+//
+// Usage: bench/build/stream [--full] [--json] [PATH]
+//
+// Parses all `.fir` files under PATH (default: ../fir) one top-level
+// declaration at a time with `fir_parse_declarations` (lib/fir_stream.h), and
+// reports throughput, the number of declarations, the largest declaration, the
+// declarations with errors and peak memory. With --full, parses each file as a
+// whole instead, for comparing peak memory: run both modes on a large file.
+// With --json, prints a single JSON object instead.
+
+#include "corpus.h"
+#include "fir_stream.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+typedef struct {
+    uint64_t declarations;
+    uint64_t error_declarations;
+    uint64_t nodes;
+    uint32_t largest_bytes;
+    uint64_t max_nodes;
+} Totals;
+
+static bool count_declaration(const TSTree *tree, TSRange range, void *payload) {
+    Totals *totals = payload;
+    TSNode root = ts_tree_root_node(tree);
+    uint32_t nodes = ts_node_descendant_count(root);
+    totals->declarations++;
+    totals->nodes += nodes;
+    if (nodes > totals->max_nodes) totals->max_nodes = nodes;
+    if (range.end_byte - range.start_byte > totals->largest_bytes) {
+        totals->largest_bytes = range.end_byte - range.start_byte;
+    }
+    if (ts_node_has_error(root)) totals->error_declarations++;
+    return true;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--full] [--json] [PATH]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    bool json = false;
+    bool full = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--full") == 0) {
+            full = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 1;
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+
+    Totals totals = {0};
+    double start = now();
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const CorpusFile *file = &corpus.files[i];
+        if (full) {
+            TSTree *tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+            TSRange range = {
+                .start_point = {0, 0},
+                .end_point = ts_node_end_point(ts_tree_root_node(tree)),
+                .start_byte = 0,
+                .end_byte = file->length,
+            };
+            count_declaration(tree, range, &totals);
+            ts_tree_delete(tree);
+        } else {
+            fir_parse_declarations(parser, file->source, file->length, count_declaration, &totals);
+        }
+    }
+    double total_time = now() - start;
+
+    double mb_per_s = (double)corpus.total_bytes / total_time / 1e6;
+    long rss_kb = peak_rss_kb();
+    const char *mode = full ? "full" : "declarations";
+
+    if (json) {
+        printf(
+            "{\"mode\": \"%s\", \"files\": %u, \"bytes\": %llu, \"seconds\": %.6f, \"mb_per_s\": %.3f, "
+            "\"declarations\": %llu, \"largest_bytes\": %u, \"max_nodes\": %llu, \"nodes\": %llu, "
+            "\"error_declarations\": %llu, \"peak_rss_kb\": %ld}\n",
+            mode, corpus.count, (unsigned long long)corpus.total_bytes, total_time, mb_per_s,
+            (unsigned long long)totals.declarations, totals.largest_bytes,
+            (unsigned long long)totals.max_nodes, (unsigned long long)totals.nodes,
+            (unsigned long long)totals.error_declarations, rss_kb
+        );
+    } else {
+        printf("mode:         %s\n", mode);
+        printf("files:        %u (%.2f MB)\n", corpus.count, (double)corpus.total_bytes / 1e6);
+        printf("throughput:   %.2f MB/s\n", mb_per_s);
+        printf("trees:        %llu (largest %u bytes, %llu nodes)\n",
+               (unsigned long long)totals.declarations, totals.largest_bytes,
+               (unsigned long long)totals.max_nodes);
+        printf("nodes:        %llu\n", (unsigned long long)totals.nodes);
+        printf("with errors:  %llu trees\n", (unsigned long long)totals.error_declarations);
+        printf("peak RSS:     %ld KB\n", rss_kb);
+    }
+
+    ts_parser_delete(parser);
+    corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// WASM grammar load and first-parse report.
+//
+// Usage: node bench/wasm.js [--json] [WASM] [PATH]
+//
+// Loads WASM (default: tree-sitter-fir.wasm, see wasm/build.sh) with
+// web-tree-sitter and reports the module size (raw, gzip and brotli), the
+// time to compile it, the time to load it as a `Language` (compile and
+// instantiate, what a page waits for), and the time of the first and second
+// parse of PATH. PATH is a `.fir` file or a directory, in which case the
+// largest `.fir` file in it is used (default: ../fir).
+
+const fs = require("node:fs");
+const path = require("node:path");
+const zlib = require("node:zlib");
+const { performance } = require("node:perf_hooks");
+const { Language, Parser } = require("web-tree-sitter");
+
+function largestFirFile(dir) {
+  let best = null;
+  for (const entry of fs.readdirSync(dir, { withFileTypes: true })) {
+    if (entry.name.startsWith(".")) continue;
+    const entryPath = path.join(dir, entry.name);
+    const candidate = entry.isDirectory()
+      ? largestFirFile(entryPath)
+      : entry.name.endsWith(".fir") ? { path: entryPath, size: fs.statSync(entryPath).size } : null;
+    if (candidate && (best === null || candidate.size > best.size)) best = candidate;
+  }
+  return best;
+}
+
+async function time(f) {
+  const start = performance.now();
+  const result = await f();
+  return [result, performance.now() - start];
+}
+
+async function main() {
+  const args = process.argv.slice(2);
+  const json = args.includes("--json");
+  const positional = args.filter((arg) => !arg.startsWith("--"));
+  const wasmPath = positional[0] ?? "tree-sitter-fir.wasm";
+  let sourcePath = positional[1] ?? "../fir";
+
+  if (fs.statSync(sourcePath).isDirectory()) {
+    const file = largestFirFile(sourcePath);
+    if (file === null) throw new Error(`no .fir files found in ${sourcePath}`);
+    sourcePath = file.path;
+  }
+
+  const bytes = fs.readFileSync(wasmPath);
+  const source = fs.readFileSync(sourcePath, "utf8");
+
+  const [, initMs] = await time(() => Parser.init());
+  const [, compileMs] = await time(() => WebAssembly.compile(bytes));
+  const [language, loadMs] = await time(() => Language.load(new Uint8Array(bytes)));
+
+  const parser = new Parser();
+  parser.setLanguage(language);
+  const [firstTree, firstParseMs] = await time(() => parser.parse(source));
+  const [secondTree, secondParseMs] = await time(() => parser.parse(source));
+  const hasError = firstTree.rootNode.hasError;
+  firstTree.delete();
+  secondTree.delete();
+  parser.delete();
+
+  const result = {
+    wasm: wasmPath,
+    bytes: bytes.length,
+    gzip_bytes: zlib.gzipSync(bytes, { level: 9 }).length,
+    brotli_bytes: zlib.brotliCompressSync(bytes).length,
+    runtime_init_ms: initMs,
+    compile_ms: compileMs,
+    load_ms: loadMs,
+    file: sourcePath,
+    file_bytes: Buffer.byteLength(source),
+    first_parse_ms: firstParseMs,
+    second_parse_ms: secondParseMs,
+    has_error: hasError,
+  };
+
+  if (json) {
+    console.log(JSON.stringify(result));
+    return;
+  }
+  const kb = (n) => `${(n / 1024).toFixed(1)} KB`;
+  const ms = (n) => `${n.toFixed(2)} ms`;
+  console.log(`module:       ${wasmPath}`);
+  console.log(`size:         ${kb(result.bytes)} (gzip ${kb(result.gzip_bytes)}, brotli ${kb(result.brotli_bytes)})`);
+  console.log(`runtime init: ${ms(initMs)}`);
+  console.log(`compile:      ${ms(compileMs)}`);
+  console.log(`load:         ${ms(loadMs)} (compile + instantiate)`);
+  console.log(`file:         ${sourcePath} (${kb(result.file_bytes)})${hasError ? ", has errors" : ""}`);
+  console.log(`first parse:  ${ms(firstParseMs)}`);
+  console.log(`second parse: ${ms(secondParseMs)}`);
+}
+
+main().catch((error) => {
+  console.error(`error: ${error.message}`);
+  process.exit(1);
+});
@@ -0,0 +1,29 @@
+const assert = require("node:assert");
+const { test } = require("node:test");
+
+const Parser = require("tree-sitter");
+
+test("can load grammar", () => {
+  const parser = new Parser();
+  assert.doesNotThrow(() => parser.setLanguage(require(".")));
+});
+
+test("outline", () => {
+  const code = "type Opt[t]:\n    Some(t)\n    None\n\nimpl ToStr[U32]:\n    toStr(self: U32) Str: \"\"\n\nVec.push(self, x: t):\n    print(x)\n";
+  const fir = require(".");
+  const parser = new Parser();
+  parser.setLanguage(fir);
+  const outline = fir.outline(parser.parse(code)).map((entry) => [
+    entry.kind,
+    code.slice(entry.nameStartIndex, entry.nameEndIndex),
+    entry.parent,
+  ]);
+  assert.deepStrictEqual(outline, [
+    ["type", "Opt", null],
+    ["constructor", "Some", 0],
+    ["constructor", "None", 0],
+    ["impl", "ToStr[U32]", null],
+    ["method", "toStr", 3],
+    ["function", "Vec.push", null],
+  ]);
+});
@@ -0,0 +1,51 @@
+type BaseNode = {
+  type: string;
+  named: boolean;
+};
+
+type ChildNode = {
+  multiple: boolean;
+  required: boolean;
+  types: BaseNode[];
+};
+
+type NodeInfo =
+  | (BaseNode & {
+      subtypes: BaseNode[];
+    })
+  | (BaseNode & {
+      fields: { [name: string]: ChildNode };
+      children: ChildNode[];
+    });
+
+type OutlineKind =
+  | "function"
+  | "type"
+  | "constructor"
+  | "trait"
+  | "impl"
+  | "method"
+  | "associatedType";
+
+type OutlineEntry = {
+  kind: OutlineKind;
+  /** The index of the enclosing type, trait or impl in the outline. */
+  parent: number | null;
+  startIndex: number;
+  endIndex: number;
+  /** `push` for a method, `Vec.push` for a function with a parent type, `ToStr[U32]` for an impl. */
+  nameStartIndex: number;
+  nameEndIndex: number;
+  startRow: number;
+  endRow: number;
+};
+
+type Language = {
+  language: unknown;
+  nodeTypeInfo: NodeInfo[];
+  /** The declarations of a tree from the `tree-sitter` package, in document order. */
+  outline(tree: import("tree-sitter").Tree): OutlineEntry[];
+};
+
+declare const language: Language;
+export = language;
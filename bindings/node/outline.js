@@ -0,0 +1,128 @@
+// A flat outline of a file's declarations, for symbol search and indexing.
+//
+// The same walk as lib/fir_outline.c, over a tree from the `tree-sitter`
+// package: the top-level functions, types and their constructors, traits and
+// impls and their items, in document order (a parent before its items). It
+// walks the top levels of the tree once with a tree cursor and doesn't enter
+// function bodies or other expressions. Declarations inside ERROR nodes are
+// skipped.
+
+const NO_PARENT = null;
+
+// The first child of the cursor's node of type `type`, or null. Only looks at
+// the direct children, and leaves the cursor where it was.
+function findChild(cursor, type) {
+  let result = null;
+  if (!cursor.gotoFirstChild()) return result;
+  do {
+    if (cursor.nodeType === type) {
+      result = cursor.currentNode;
+      break;
+    }
+  } while (cursor.gotoNextSibling());
+  cursor.gotoParent();
+  return result;
+}
+
+function push(entries, kind, parent, node, nameStartIndex, nameEndIndex) {
+  entries.push({
+    kind,
+    parent,
+    startIndex: node.startIndex,
+    endIndex: node.endIndex,
+    nameStartIndex,
+    nameEndIndex,
+    startRow: node.startPosition.row,
+    endRow: node.endPosition.row,
+  });
+  return entries.length - 1;
+}
+
+// The name of a function is the first child of its `fun_sig`, preceded by the
+// parent type if it has one.
+function addFunction(entries, cursor, kind, parent) {
+  const node = cursor.currentNode;
+  const sig = findChild(cursor, "fun_sig");
+  if (sig === null || sig.childCount === 0) return;
+  const name = sig.child(0);
+  let nameStartIndex = name.startIndex;
+  if (kind === "function") {
+    const parentType = findChild(cursor, "parent_type");
+    if (parentType !== null) nameStartIndex = parentType.startIndex;
+  }
+  push(entries, kind, parent, node, nameStartIndex, name.endIndex);
+}
+
+// Declarations named by their first `upper_id`.
+function addNamed(entries, cursor, kind, parent) {
+  const node = cursor.currentNode;
+  const name = findChild(cursor, "upper_id") ?? node;
+  let nameEndIndex = name.endIndex;
+  // An impl's name runs to the `]` of the trait's arguments. A context has its
+  // own brackets, but they aren't direct children.
+  if (kind === "impl") {
+    const rbracket = findChild(cursor, "rbracket");
+    if (rbracket !== null) nameEndIndex = rbracket.endIndex;
+  }
+  return push(entries, kind, parent, node, name.startIndex, nameEndIndex);
+}
+
+// Add the items of the cursor's node: the constructors of a type, and the
+// functions and types of a trait or impl. Other children are skipped without
+// entering them.
+function addItems(entries, cursor, parent) {
+  if (!cursor.gotoFirstChild()) return;
+  do {
+    switch (cursor.nodeType) {
+      case "trait_function_declaration":
+      case "impl_function_declaration":
+        addFunction(entries, cursor, "method", parent);
+        break;
+      case "trait_type_declaration":
+      case "impl_type_declaration":
+        addNamed(entries, cursor, "associatedType", parent);
+        break;
+      case "constructor_declaration":
+        addNamed(entries, cursor, "constructor", parent);
+        break;
+      case "constructor_list":
+        addItems(entries, cursor, parent);
+        break;
+    }
+  } while (cursor.gotoNextSibling());
+  cursor.gotoParent();
+}
+
+/**
+ * The outline of `tree`, a tree parsed with this grammar by the `tree-sitter`
+ * package. Each entry has the `kind` of the declaration, the index of its
+ * enclosing type, trait or impl in the outline (`parent`, null at the top
+ * level), its range (`startIndex`, `endIndex`, `startRow`, `endRow`) and the
+ * range of its name (`nameStartIndex`, `nameEndIndex`): `push` for a method,
+ * `Vec.push` for a function with a parent type, `ToStr[U32]` for an impl.
+ */
+function outline(tree) {
+  const entries = [];
+  const cursor = tree.walk();
+  if (cursor.gotoFirstChild()) {
+    do {
+      switch (cursor.nodeType) {
+        case "function_declaration":
+          addFunction(entries, cursor, "function", NO_PARENT);
+          break;
+        case "type_declaration":
+          addItems(entries, cursor, addNamed(entries, cursor, "type", NO_PARENT));
+          break;
+        case "trait_declaration":
+          addItems(entries, cursor, addNamed(entries, cursor, "trait", NO_PARENT));
+          break;
+        case "impl_declaration":
+          addItems(entries, cursor, addNamed(entries, cursor, "impl", NO_PARENT));
+          break;
+      }
+    } while (cursor.gotoNextSibling());
+  }
+  return entries;
+}
+
+module.exports = { outline };
@@ -0,0 +1,30 @@
+from unittest import TestCase
+
+import tree_sitter
+import tree_sitter_fir
+
+
+class TestLanguage(TestCase):
+    def test_can_load_grammar(self):
+        try:
+            tree_sitter.Language(tree_sitter_fir.language())
+        except Exception:
+            self.fail("Error loading Fir grammar")
+
+    def test_outline(self):
+        code = b"type Opt[t]:\n    Some(t)\n    None\n\nimpl ToStr[U32]:\n    toStr(self: U32) Str: \"\"\n\nVec.push(self, x: t):\n    print(x)\n"
+        parser = tree_sitter.Parser(tree_sitter.Language(tree_sitter_fir.language()))
+        tree = parser.parse(code)
+        outline = [
+            (entry.kind, entry.name(code), entry.parent)
+            for entry in tree_sitter_fir.outline(tree)
+        ]
+        OutlineKind = tree_sitter_fir.OutlineKind
+        self.assertEqual(outline, [
+            (OutlineKind.TYPE, "Opt", None),
+            (OutlineKind.CONSTRUCTOR, "Some", 0),
+            (OutlineKind.CONSTRUCTOR, "None", 0),
+            (OutlineKind.IMPL, "ToStr[U32]", None),
+            (OutlineKind.METHOD, "toStr", 3),
+            (OutlineKind.FUNCTION, "Vec.push", None),
+        ])
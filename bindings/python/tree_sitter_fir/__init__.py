@@ -0,0 +1,44 @@
+"""Fir grammar for tree-sitter"""
+
+from importlib.resources import files as _files
+
+from ._binding import language
+from ._outline import OutlineEntry, OutlineKind, outline
+
+
+def _get_query(name, file):
+    query = _files(f"{__package__}.queries") / file
+    globals()[name] = query.read_text()
+    return globals()[name]
+
+
+def __getattr__(name):
+    if name == "HIGHLIGHTS_QUERY":
+        return _get_query("HIGHLIGHTS_QUERY", "highlights.scm")
+    if name == "TAGS_QUERY":
+        return _get_query("TAGS_QUERY", "tags.scm")
+    if name == "INDENTS_QUERY":
+        return _get_query("INDENTS_QUERY", "indents.scm")
+    if name == "FOLDS_QUERY":
+        return _get_query("FOLDS_QUERY", "folds.scm")
+
+    raise AttributeError(f"module {__name__!r} has no attribute {name!r}")
+
+
+__all__ = [
+    "language",
+    "outline",
+    "OutlineEntry",
+    "OutlineKind",
+    "HIGHLIGHTS_QUERY",
+    "TAGS_QUERY",
+    "INDENTS_QUERY",
+    "FOLDS_QUERY",
+]
+
+
+def __dir__():
+    return sorted(__all__ + [
+        "__all__", "__builtins__", "__cached__", "__doc__", "__file__",
+        "__loader__", "__name__", "__package__", "__path__", "__spec__",
+    ])
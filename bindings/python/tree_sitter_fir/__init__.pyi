@@ -0,0 +1,10 @@
+from typing import Final
+
+from ._outline import OutlineEntry as OutlineEntry, OutlineKind as OutlineKind, outline as outline
+
+HIGHLIGHTS_QUERY: Final[str]
+TAGS_QUERY: Final[str]
+INDENTS_QUERY: Final[str]
+FOLDS_QUERY: Final[str]
+
+def language() -> object: ...
@@ -0,0 +1,157 @@
+"""A flat outline of a file's declarations, for symbol search and indexing.
+
+The same walk as lib/fir_outline.c, over a tree from the `tree_sitter`
+package: the top-level functions, types and their constructors, traits and
+impls and their items, in document order (a parent before its items). It walks
+the top levels of the tree once with a tree cursor and doesn't enter function
+bodies or other expressions. Declarations inside ERROR nodes are skipped.
+"""
+
+from dataclasses import dataclass
+from enum import Enum
+
+
+class OutlineKind(Enum):
+    FUNCTION = "function"
+    TYPE = "type"
+    CONSTRUCTOR = "constructor"
+    TRAIT = "trait"
+    IMPL = "impl"
+    METHOD = "method"
+    """A function in a trait or impl."""
+    ASSOCIATED_TYPE = "associated_type"
+    """A type in a trait or impl."""
+
+
+@dataclass(frozen=True)
+class OutlineEntry:
+    kind: OutlineKind
+    parent: int | None
+    """The index of the enclosing type, trait or impl in the outline."""
+    start_byte: int
+    end_byte: int
+    name_start_byte: int
+    """The name in the source: `push` for a method, `Vec.push` for a function
+    with a parent type, `ToStr[U32]` for an impl."""
+    name_end_byte: int
+    start_row: int
+    end_row: int
+
+    def name(self, source: bytes) -> str:
+        return source[self.name_start_byte:self.name_end_byte].decode()
+
+
+def _find_child(cursor, type):
+    """The first child of the cursor's node of type `type`, or None.
+
+    Only looks at the direct children, and leaves the cursor where it was.
+    """
+    result = None
+    if not cursor.goto_first_child():
+        return result
+    while True:
+        if cursor.node.type == type:
+            result = cursor.node
+            break
+        if not cursor.goto_next_sibling():
+            break
+    cursor.goto_parent()
+    return result
+
+
+def _push(entries, kind, parent, node, name_start_byte, name_end_byte):
+    entries.append(OutlineEntry(
+        kind=kind,
+        parent=parent,
+        start_byte=node.start_byte,
+        end_byte=node.end_byte,
+        name_start_byte=name_start_byte,
+        name_end_byte=name_end_byte,
+        start_row=node.start_point.row,
+        end_row=node.end_point.row,
+    ))
+    return len(entries) - 1
+
+
+def _add_function(entries, cursor, kind, parent):
+    # The name of a function is the first child of its `fun_sig`, preceded by
+    # the parent type if it has one.
+    node = cursor.node
+    sig = _find_child(cursor, "fun_sig")
+    if sig is None or sig.child_count == 0:
+        return
+    name = sig.child(0)
+    name_start_byte = name.start_byte
+    if kind is OutlineKind.FUNCTION:
+        parent_type = _find_child(cursor, "parent_type")
+        if parent_type is not None:
+            name_start_byte = parent_type.start_byte
+    _push(entries, kind, parent, node, name_start_byte, name.end_byte)
+
+
+def _add_named(entries, cursor, kind, parent):
+    # Declarations named by their first `upper_id`.
+    node = cursor.node
+    name = _find_child(cursor, "upper_id") or node
+    name_end_byte = name.end_byte
+    # An impl's name runs to the `]` of the trait's arguments. A context has
+    # its own brackets, but they aren't direct children.
+    if kind is OutlineKind.IMPL:
+        rbracket = _find_child(cursor, "rbracket")
+        if rbracket is not None:
+            name_end_byte = rbracket.end_byte
+    return _push(entries, kind, parent, node, name.start_byte, name_end_byte)
+
+
+_ITEM_KINDS = {
+    "trait_function_declaration": OutlineKind.METHOD,
+    "impl_function_declaration": OutlineKind.METHOD,
+    "trait_type_declaration": OutlineKind.ASSOCIATED_TYPE,
+    "impl_type_declaration": OutlineKind.ASSOCIATED_TYPE,
+    "constructor_declaration": OutlineKind.CONSTRUCTOR,
+}
+
+
+def _add_items(entries, cursor, parent):
+    # The constructors of a type, and the functions and types of a trait or
+    # impl. Other children are skipped without entering them.
+    if not cursor.goto_first_child():
+        return
+    while True:
+        type = cursor.node.type
+        kind = _ITEM_KINDS.get(type)
+        if kind is OutlineKind.METHOD:
+            _add_function(entries, cursor, kind, parent)
+        elif kind is not None:
+            _add_named(entries, cursor, kind, parent)
+        elif type == "constructor_list":
+            _add_items(entries, cursor, parent)
+        if not cursor.goto_next_sibling():
+            break
+    cursor.goto_parent()
+
+
+_DECLARATION_KINDS = {
+    "type_declaration": OutlineKind.TYPE,
+    "trait_declaration": OutlineKind.TRAIT,
+    "impl_declaration": OutlineKind.IMPL,
+}
+
+
+def outline(tree) -> list[OutlineEntry]:
+    """The declarations of `tree`, a tree parsed with this grammar by the
+    `tree_sitter` package, in document order."""
+    entries = []
+    cursor = tree.walk()
+    if not cursor.goto_first_child():
+        return entries
+    while True:
+        type = cursor.node.type
+        if type == "function_declaration":
+            _add_function(entries, cursor, OutlineKind.FUNCTION, None)
+        elif type in _DECLARATION_KINDS:
+            parent = _add_named(entries, cursor, _DECLARATION_KINDS[type], None)
+            _add_items(entries, cursor, parent)
+        if not cursor.goto_next_sibling():
+            break
+    return entries
@@ -0,0 +1,37 @@
+fn main() {
+    let src_dir = std::path::Path::new("src");
+
+    let mut c_config = cc::Build::new();
+    c_config
+        .std("c11")
+        .include(src_dir)
+        .flag_if_supported("-Wno-unused-parameter")
+        .flag_if_supported("-Wno-unused-but-set-variable")
+        .flag_if_supported("-Wno-trigraphs");
+    // The generated parser is much slower unoptimized, so optimize it in debug
+    // builds too.
+    c_config.opt_level(2);
+
+    #[cfg(target_env = "msvc")]
+    c_config.flag("-utf-8");
+
+    let parser_path = src_dir.join("parser.c");
+    c_config.file(&parser_path);
+    println!("cargo:rerun-if-changed={}", parser_path.to_str().unwrap());
+
+    let scanner_path = src_dir.join("scanner.c");
+    c_config.file(&scanner_path);
+    println!("cargo:rerun-if-changed={}", scanner_path.to_str().unwrap());
+
+    // The outline API includes tree_sitter/api.h, from the tree-sitter crate.
+    if std::env::var_os("CARGO_FEATURE_OUTLINE").is_some() {
+        let outline_path = std::path::Path::new("lib").join("fir_outline.c");
+        c_config.file(&outline_path);
+        if let Some(include) = std::env::var_os("DEP_TREE_SITTER_INCLUDE") {
+            c_config.include(include);
+        }
+        println!("cargo:rerun-if-changed={}", outline_path.to_str().unwrap());
+    }
+
+    c_config.compile("tree-sitter-fir");
+}
@@ -0,0 +1,89 @@
+//! This crate provides Fir language support for the [tree-sitter] parsing library.
+//!
+//! Typically, you will use the [`LANGUAGE`] constant to add this language to a
+//! tree-sitter [`Parser`], and then use the parser to parse some code:
+//!
+//! ```
+//! let code = r#"
+//! main():
+//!     print("Hello")
+//! "#;
+//! let mut parser = tree_sitter::Parser::new();
+//! let language = tree_sitter_fir::LANGUAGE;
+//! parser
+//!     .set_language(&language.into())
+//!     .expect("Error loading Fir parser");
+//! let tree = parser.parse(code, None).unwrap();
+//! assert!(!tree.root_node().has_error());
+//! ```
+//!
+//! [`Parser`]: https://docs.rs/tree-sitter/*/tree_sitter/struct.Parser.html
+//! [tree-sitter]: https://tree-sitter.github.io/
+
+use tree_sitter_language::LanguageFn;
+
+extern "C" {
+    fn tree_sitter_fir() -> *const ();
+}
+
+/// The tree-sitter [`LanguageFn`] for this grammar.
+pub const LANGUAGE: LanguageFn = unsafe { LanguageFn::from_raw(tree_sitter_fir) };
+
+/// The content of the [`node-types.json`] file for this grammar.
+///
+/// [`node-types.json`]: https://tree-sitter.github.io/tree-sitter/using-parsers/6-static-node-types
+pub const NODE_TYPES: &str = include_str!("../../src/node-types.json");
+
+/// The syntax highlighting query for this grammar.
+pub const HIGHLIGHTS_QUERY: &str = include_str!("../../queries/highlights.scm");
+
+/// The symbol tagging query for this grammar.
+pub const TAGS_QUERY: &str = include_str!("../../queries/tags.scm");
+
+/// The indentation query for this grammar.
+pub const INDENTS_QUERY: &str = include_str!("../../queries/indents.scm");
+
+/// The folding query for this grammar.
+pub const FOLDS_QUERY: &str = include_str!("../../queries/folds.scm");
+
+#[cfg(feature = "outline")]
+mod outline;
+#[cfg(feature = "outline")]
+pub use outline::{outline, OutlineEntry, OutlineKind};
+
+#[cfg(test)]
+mod tests {
+    #[test]
+    fn test_can_load_grammar() {
+        let mut parser = tree_sitter::Parser::new();
+        parser
+            .set_language(&super::LANGUAGE.into())
+            .expect("Error loading Fir parser");
+    }
+
+    #[cfg(feature = "outline")]
+    #[test]
+    fn test_outline() {
+        use super::OutlineKind;
+
+        let code = "type Opt[t]:\n    Some(t)\n    None\n\nimpl ToStr[U32]:\n    toStr(self: U32) Str: \"\"\n\nVec.push(self, x: t):\n    print(x)\n";
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(&super::LANGUAGE.into()).unwrap();
+        let tree = parser.parse(code, None).unwrap();
+        let outline: Vec<_> = super::outline(&tree)
+            .iter()
+            .map(|entry| (entry.kind(), entry.name(code), entry.parent()))
+            .collect();
+        assert_eq!(
+            outline,
+            [
+                (OutlineKind::Type, "Opt", None),
+                (OutlineKind::Constructor, "Some", Some(0)),
+                (OutlineKind::Constructor, "None", Some(0)),
+                (OutlineKind::Impl, "ToStr[U32]", None),
+                (OutlineKind::Method, "toStr", Some(3)),
+                (OutlineKind::Function, "Vec.push", None),
+            ]
+        );
+    }
+}
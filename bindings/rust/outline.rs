@@ -0,0 +1,101 @@
+//! A flat outline of a file's declarations, from `lib/fir_outline.c`.
+
+use tree_sitter::{ffi::TSTree, Tree};
+
+extern "C" {
+    fn fir_outline(tree: *const TSTree, entries: *mut OutlineEntry, capacity: u32) -> u32;
+}
+
+/// The kind of an [`OutlineEntry`].
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum OutlineKind {
+    Function,
+    Type,
+    Constructor,
+    Trait,
+    Impl,
+    /// A function in a trait or impl.
+    Method,
+    /// A type in a trait or impl.
+    AssociatedType,
+}
+
+/// One declaration in an outline. It has the layout of `FirOutlineEntry`, so
+/// the C side writes the entries directly into the [`Vec`] returned by
+/// [`outline`].
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct OutlineEntry {
+    kind: u32,
+    parent: u32,
+    start_byte: u32,
+    end_byte: u32,
+    name_start_byte: u32,
+    name_end_byte: u32,
+    start_row: u32,
+    end_row: u32,
+}
+
+impl OutlineEntry {
+    pub fn kind(&self) -> OutlineKind {
+        match self.kind {
+            0 => OutlineKind::Function,
+            1 => OutlineKind::Type,
+            2 => OutlineKind::Constructor,
+            3 => OutlineKind::Trait,
+            4 => OutlineKind::Impl,
+            5 => OutlineKind::Method,
+            _ => OutlineKind::AssociatedType,
+        }
+    }
+
+    /// The index of the enclosing type, trait or impl in the outline.
+    pub fn parent(&self) -> Option<usize> {
+        (self.parent != u32::MAX).then_some(self.parent as usize)
+    }
+
+    pub fn byte_range(&self) -> std::ops::Range<usize> {
+        self.start_byte as usize..self.end_byte as usize
+    }
+
+    /// The range of the name in the source: `push` for a method, `Vec.push`
+    /// for a function with a parent type, `ToStr[U32]` for an impl.
+    pub fn name_range(&self) -> std::ops::Range<usize> {
+        self.name_start_byte as usize..self.name_end_byte as usize
+    }
+
+    pub fn name<'a>(&self, source: &'a str) -> &'a str {
+        &source[self.name_range()]
+    }
+
+    pub fn start_row(&self) -> usize {
+        self.start_row as usize
+    }
+
+    pub fn end_row(&self) -> usize {
+        self.end_row as usize
+    }
+}
+
+/// The top-level declarations of `tree` and the items of its types, traits and
+/// impls, in document order. Walks the top levels of the tree once, without
+/// entering function bodies, and allocates only the returned [`Vec`] (unless
+/// the first guess of its size is too small).
+pub fn outline(tree: &Tree) -> Vec<OutlineEntry> {
+    // Copying a tree only takes a reference, and gives us a pointer to it.
+    let raw = tree.clone().into_raw();
+    // Most declarations have a few items at most.
+    let mut entries: Vec<OutlineEntry> =
+        Vec::with_capacity(2 * tree.root_node().child_count() + 16);
+    loop {
+        let capacity = entries.capacity().min(u32::MAX as usize);
+        let count = unsafe { fir_outline(raw, entries.as_mut_ptr(), capacity as u32) } as usize;
+        if count <= capacity {
+            unsafe { entries.set_len(count) };
+            break;
+        }
+        entries.reserve_exact(count);
+    }
+    drop(unsafe { Tree::from_raw(raw) });
+    entries
+}
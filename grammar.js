@@ -10,32 +10,33 @@ function sep1(rule, separator) {
   return seq(rule, repeat(seq(separator, rule)));
 }
 
-// Constructor path: covers Con, Con[..], Type.Con, Type[..].Con, Type.Con[..], Type[..].Con[..]
-// Returns an array suitable for spreading into a seq().
-function conPathParts($) {
-  return [
-    optional($.module_prefix),
-    $.upper_id,
-    optional(seq($.lbracket, sep1($._type, $._comma), $.rbracket)),
-    optional(seq(
-      $._dot,
-      $.upper_id,
-      optional(seq($.lbracket, sep1($._type, $._comma), $.rbracket)),
-    )),
-  ];
-}
-
 module.exports = grammar({
   name: 'fir',
 
-  // word: $ => $.lower_id,  // Disabled: all tokens are external, keywords handled by scanner
-
-  extras: $ => [$.line_comment, $.block_comment],
-
-  conflicts: $ => [
-    [$.constructor_expression, $.sequence_expression],
-    [$.constructor_expression],
-  ],
+  // Identifiers, keywords, punctuation and operators are lexed by the
+  // generated lexer. The keywords are extracted from `lower_id`, so the lexer
+  // matches an identifier once and then looks it up in the keyword table.
+  // Tokens that stay external:
+  //
+  // - Layout tokens (_start_block, _end_block, _newline).
+  // - String tokens: the scanner tracks whether it's inside a string.
+  // - Delimiters: lparen, lbracket, lbrace, backslash_lparen push frames and
+  //   rparen, rbracket, rbrace pop them. Newlines are only significant in
+  //   indented frames.
+  // - label and char_literal, which both start with `'`.
+  // - module_prefix, which overlaps with upper_id followed by _slash.
+  // - int_literal.
+  word: $ => $.lower_id,
+
+  // The scanner skips the whitespace it doesn't turn into layout tokens, but
+  // when it returns false the generated lexer starts over where the scanner
+  // started.
+  extras: $ => [$.line_comment, $.block_comment, /\s/],
+
+  // `Type.Con` and `Vec.[...]` use `_path_dot`, so that after `Type` the
+  // next token says whether it's a path or the object of a field access
+  // (`Vec.withCapacity`), without forking.
+  conflicts: $ => [],
 
   externals: $ => [
     // Layout tokens (0-2)
@@ -43,28 +44,26 @@ module.exports = grammar({
     $._end_block,     // emitted by scanner when block ends (DEDENT)
     $._newline,
 
-    // Identifiers (3-6)
-    $.upper_id,
-    $.lower_id,
+    // Identifiers (3-4)
     $.module_prefix,             // (UpperId '/')+ — e.g. "Fir/", "M1/M2/"
     $.label,                     // 'ident
 
-    // Literals (10-11)
+    // Literals (5-6)
     $.int_literal,
     $.char_literal,
 
-    // String tokens (12-16)
+    // String tokens (7-11)
     $.begin_str,
     $.end_str,
     $.string_content,
     $.begin_interpolation,
     $.end_interpolation,
 
-    // Comments (17-18)
+    // Comments (12-13)
     $.block_comment,
     $.line_comment,
 
-    // Delimiters (19-26)
+    // Delimiters (14-21)
     $.lparen,           // (
     $.rparen,           // )
     $.lbracket,         // [
@@ -74,69 +73,10 @@ module.exports = grammar({
     $.backslash_lparen,  // \(
     $.hash_lbracket,    // #[ (start of attribute)
 
-    // Punctuation (27-33)
-    $._colon,           // :
-    $._comma,           // ,
-    $._dot,             // .
-    $._dotdot,          // ..
-    $._eq,              // =
-    $._underscore,      // _
-    $._slash,           // /
-    $._semicolon,       // ;
-
-    // Operators (34-56)
-    $._plus,            // +
-    $._minus,           // -
-    $._star,            // *
-    $._eqeq,           // ==
-    $._neq,            // !=
-    $._lt,             // <
-    $._gt,             // >
-    $._lteq,           // <=
-    $._gteq,           // >=
-    $._lshift,         // <<
-    $._rshift,         // >>
-    $._amp,            // &
-    $._ampamp,         // &&
-    $._pipe,           // |
-    $._tilde,          // ~
-    $._exclamation,    // !
-    $._percent,        // %
-    $._caret,          // ^
-    $._pluseq,         // +=
-    $._minuseq,        // -=
-    $._stareq,         // *=
-    $._careteq,        // ^=
-
-    // Keywords (57+) - named for highlighting
-    $.kw_and,
-    $.kw_as,
-    $.kw_break,
-    $.kw_continue,
-    $.kw_do,
-    $.kw_elif,
-    $.kw_else,
-    $.kw_extern,
-    $.kw_fn,
-    $.kw_upper_fn,    // Fn
-    $.kw_for,
-    $.kw_if,
-    $.kw_impl,
-    $.kw_import,
-    $.kw_in,
-    $.kw_is,
-    $.kw_let,
-    $.kw_loop,
-    $.kw_match,
-    $.kw_not,
-    $.kw_or,
-    $.kw_prim,
-    $.kw_return,
-    $.kw_trait,
-    $.kw_type,
-    $.kw_value,
-    $.kw_while,
-    $.kw_row,
+    // A string without interpolation, scanned as one token.
+    $._string_literal,
+    // `.` followed by an upper-case letter or `[`.
+    $._path_dot,
   ],
 
   rules: {
@@ -154,23 +94,23 @@ module.exports = grammar({
 
     type_declaration: $ => choice(
       // [value] type Name TypeDeclRhs
-      seq(optional($.attribute), optional($.kw_value), $.kw_type, $.upper_id, $._type_decl_rhs),
+      seq(optional($.attribute), optional($.kw_value), $.kw_type, field('name', $.upper_id), $._type_decl_rhs),
       // [value] type Name[TypeParams] TypeDeclRhs
-      seq(optional($.attribute), optional($.kw_value), $.kw_type, $.upper_id, $.lbracket, $.type_params, $._type_decl_rhs),
+      seq(optional($.attribute), optional($.kw_value), $.kw_type, field('name', $.upper_id), $.lbracket, field('type_params', $.type_params), $._type_decl_rhs),
       // prim type Name NEWLINE
-      seq(optional($.attribute), $.kw_prim, $.kw_type, $.upper_id, $._newline),
+      seq(optional($.attribute), $.kw_prim, $.kw_type, field('name', $.upper_id), $._newline),
       // prim type Name[TypeParams] NEWLINE
-      seq(optional($.attribute), $.kw_prim, $.kw_type, $.upper_id, $.lbracket, $.type_params, $._newline),
+      seq(optional($.attribute), $.kw_prim, $.kw_type, field('name', $.upper_id), $.lbracket, field('type_params', $.type_params), $._newline),
       // extern type Name = "c_type" [ ( field, ... ) ]
       seq(
-        $.kw_extern, $.kw_type, $.upper_id, $._eq, $.string_expression,
+        $.kw_extern, $.kw_type, field('name', $.upper_id), $._eq, $.string_expression,
         optional(seq($.lparen, sep($.extern_type_field, $._comma), $.rparen)),
         $._newline,
       ),
     ),
 
     extern_type_field: $ => seq(
-      $.lower_id, $._colon, $._type, $._eq, $.string_expression,
+      field('name', $.lower_id), $._colon, field('type', $._type), $._eq, $.string_expression,
     ),
 
     attribute: $ => seq(
@@ -192,7 +132,7 @@ module.exports = grammar({
       seq($.lparen, sep($.field, $._comma), optional($.row_extension), $.rparen, $._newline),
     ),
 
-    type_param: $ => seq($.lower_id, optional(seq($._colon, $._type))),
+    type_param: $ => seq(field('name', $.lower_id), optional(seq($._colon, field('bound', $._type)))),
 
     type_params: $ => seq(sep($.type_param, $._comma), $.rbracket),
 
@@ -205,11 +145,11 @@ module.exports = grammar({
     row_extension_line: $ => seq($._dotdot, $._type_no_fn, $._newline),
 
     constructor_declaration: $ => choice(
-      seq($.upper_id, $._newline),
-      seq($.upper_id, $.lparen, sep($.field, $._comma), optional($.row_extension), $.rparen, $._newline),
+      seq(field('name', $.upper_id), $._newline),
+      seq(field('name', $.upper_id), $.lparen, sep($.field, $._comma), optional($.row_extension), $.rparen, $._newline),
     ),
 
-    field: $ => seq(optional(seq($.lower_id, $._colon)), $._type),
+    field: $ => seq(optional(seq(field('name', $.lower_id), $._colon)), field('type', $._type)),
 
     // ==================== Types ====================
 
@@ -224,8 +164,8 @@ module.exports = grammar({
     ),
 
     named_type: $ => choice(
-      seq(optional($.module_prefix), $.upper_id),
-      seq(optional($.module_prefix), $.upper_id, $.lbracket, sep($._type, $._comma), $.rbracket),
+      seq(optional($.module_prefix), field('name', $.upper_id)),
+      seq(optional($.module_prefix), field('name', $.upper_id), $.lbracket, sep($._type, $._comma), $.rbracket),
     ),
 
     // Associated type selection: Foo[t].A, Iterator[iter, exn].Item
@@ -252,7 +192,7 @@ module.exports = grammar({
       seq(optional($.module_prefix), $.upper_id, $.lbracket, sep($._type, $._comma), $.rbracket),
     ),
 
-    record_type_field: $ => seq($.lower_id, $._colon, $._type),
+    record_type_field: $ => seq(field('name', $.lower_id), $._colon, field('type', $._type)),
 
     row_extension: $ => seq($._dotdot, $._type_no_fn),
 
@@ -276,9 +216,9 @@ module.exports = grammar({
 
     function_declaration: $ => choice(
       // Block body
-      seq(optional($.parent_type), $._fun_sig, $._colon, $._start_block, $.statements, $._end_block),
+      seq(optional($.parent_type), $._fun_sig, $._colon, $._start_block, field('body', $.statements), $._end_block),
       // Inline body
-      seq(optional($.parent_type), $._fun_sig, $._colon, $._inline_expr, $._newline),
+      seq(optional($.parent_type), $._fun_sig, $._colon, field('body', $._inline_expr), $._newline),
       // No body / prim
       seq(optional($.kw_prim), optional($.parent_type), $._fun_sig, $._newline),
     ),
@@ -288,15 +228,15 @@ module.exports = grammar({
     _fun_sig: $ => $.fun_sig,
 
     fun_sig: $ => seq(
-      $.lower_id,
-      optional($.context),
-      $.param_list,
-      optional($._return_type),
+      field('name', $.lower_id),
+      optional(field('context', $.context)),
+      field('params', $.param_list),
+      optional(field('return_type', $._return_type)),
     ),
 
     param_list: $ => seq($.lparen, sep($.param, $._comma), $.rparen),
 
-    param: $ => seq($.lower_id, optional(seq($._colon, $._type))),
+    param: $ => seq(field('name', $.lower_id), optional(seq($._colon, field('type', $._type)))),
 
     context: $ => seq($.lbracket, sep($.predicate, $._comma), $.rbracket),
 
@@ -327,13 +267,13 @@ module.exports = grammar({
     continue_statement: $ => seq($.kw_continue, optional($.label), $._newline),
 
     let_statement: $ => choice(
-      seq($.kw_let, $._pattern, optional(seq($._colon, $._type)), $._eq, $._inline_expr, $._newline),
-      seq($.kw_let, $._pattern, optional(seq($._colon, $._type)), $._eq, $._block_expr),
+      seq($.kw_let, field('pattern', $._pattern), optional(seq($._colon, field('type', $._type))), $._eq, field('value', $._inline_expr), $._newline),
+      seq($.kw_let, field('pattern', $._pattern), optional(seq($._colon, field('type', $._type))), $._eq, field('value', $._block_expr)),
     ),
 
     assign_statement: $ => choice(
-      seq($._inline_expr, $._assign_op, $._inline_expr, $._newline),
-      seq($._inline_expr, $._assign_op, $._block_expr),
+      seq(field('left', $._inline_expr), $._assign_op, field('right', $._inline_expr), $._newline),
+      seq(field('left', $._inline_expr), $._assign_op, field('right', $._block_expr)),
     ),
 
     _assign_op: $ => choice($._eq, $._pluseq, $._minuseq, $._stareq, $._careteq),
@@ -344,24 +284,36 @@ module.exports = grammar({
     ),
 
     for_statement: $ => seq(
-      optional($.label), $.kw_for, $._pattern, optional(seq($._colon, $._type)),
-      $.kw_in, $._expr, $._colon, $._start_block, $.statements, $._end_block,
+      optional(field('label', $.label)), $.kw_for, field('pattern', $._pattern), optional(seq($._colon, field('type', $._type))),
+      $.kw_in, field('iterable', $._expr), $._colon, $._start_block, field('body', $.statements), $._end_block,
     ),
 
     while_statement: $ => seq(
-      optional($.label), $.kw_while, $._expr, $._colon,
-      $._start_block, $.statements, $._end_block,
+      optional(field('label', $.label)), $.kw_while, field('condition', $._expr), $._colon,
+      $._start_block, field('body', $.statements), $._end_block,
     ),
 
     loop_statement: $ => seq(
-      optional($.label), $.kw_loop, $._colon,
-      $._start_block, $.statements, $._end_block,
+      optional(field('label', $.label)), $.kw_loop, $._colon,
+      $._start_block, field('body', $.statements), $._end_block,
     ),
 
     // ==================== Expressions ====================
 
     _expr: $ => choice($._inline_expr, $._block_expr),
 
+    // Constructor path: covers Con, Con[..], Type.Con, Type[..].Con, Type.Con[..], Type[..].Con[..].
+    // Constructor expressions and patterns share it, so the parser has one set
+    // of states for paths instead of one per use.
+    _con_path: $ => seq(
+      optional($.module_prefix),
+      $.upper_id,
+      optional($._con_type_args),
+      optional(seq($._path_dot, $.upper_id, optional($._con_type_args))),
+    ),
+
+    _con_type_args: $ => seq($.lbracket, sep1($._type, $._comma), $.rbracket),
+
     _inline_expr: $ => choice(
       $.variable_expression,
       $.constructor_expression,
@@ -388,9 +340,9 @@ module.exports = grammar({
       $.return_block_expression,
     ),
 
-    variable_expression: $ => prec(0, seq(optional($.module_prefix), $.lower_id, optional($.type_arguments))),
+    variable_expression: $ => prec(0, seq(optional($.module_prefix), field('name', $.lower_id), optional($.type_arguments))),
 
-    constructor_expression: $ => prec(0, seq(...conPathParts($))),
+    constructor_expression: $ => prec(0, $._con_path),
 
     parenthesized_expression: $ => prec(0, seq($.lparen, $._expr, $.rparen)),
 
@@ -401,76 +353,84 @@ module.exports = grammar({
       $.rparen,
     )),
 
-    record_field_expression: $ => seq($.lower_id, $._eq, $._expr),
+    record_field_expression: $ => seq(field('name', $.lower_id), $._eq, field('value', $._expr)),
 
-    string_expression: $ => seq(
-      $.begin_str,
-      repeat(choice($.string_content, $.string_interpolation)),
-      $.end_str,
+    string_expression: $ => choice(
+      seq(
+        $.begin_str,
+        repeat(choice($.string_content, $.string_interpolation)),
+        $.end_str,
+      ),
+      $._string_literal,
     ),
 
     string_interpolation: $ => seq($.begin_interpolation, $._expr, $.end_interpolation),
 
     call_expression: $ => prec.left(15, seq(
-      $._inline_expr, $.lparen,
-      repeat(seq($.call_argument, $._comma)),
-      optional(choice($.call_argument, seq($._dotdot, $._inline_expr))),
+      field('callee', $._inline_expr), $.lparen,
+      repeat(seq(field('args', $.call_argument), $._comma)),
+      optional(choice(field('args', $.call_argument), seq($._dotdot, $._inline_expr))),
       $.rparen,
     )),
 
-    field_access_expression: $ => prec.left(15, seq($._inline_expr, $._dot, $.lower_id, optional($.type_arguments))),
+    field_access_expression: $ => prec.left(15, seq(field('object', $._inline_expr), $._dot, field('field', $.lower_id), optional($.type_arguments))),
 
     sequence_expression: $ => prec(0, choice(
-      seq($.lbracket, sep($.sequence_element, $._comma), $.rbracket),
-      seq(optional($.module_prefix), $.upper_id, $._dot, $.lbracket, sep($.sequence_element, $._comma), $.rbracket),
+      $._sequence_elements,
+      seq(optional($.module_prefix), $.upper_id, $._path_dot, $._sequence_elements),
     )),
 
+    _sequence_elements: $ => seq($.lbracket, sep($.sequence_element, $._comma), $.rbracket),
+
     sequence_element: $ => choice(
       $._inline_expr,
       seq($._inline_expr, $._eq, $._inline_expr),
     ),
 
     unary_expression: $ => choice(
-      prec(3, seq($.kw_not, $._inline_expr)),
-      prec(3, seq($._minus, $._inline_expr)),
-      prec(3, seq($._tilde, $._inline_expr)),
+      prec(3, seq($.kw_not, field('operand', $._inline_expr))),
+      prec(3, seq($._minus, field('operand', $._inline_expr))),
+      prec(3, seq($._tilde, field('operand', $._inline_expr))),
     ),
 
     binary_expression: $ => choice(
-      prec.left(5, seq($._inline_expr, $._star, $._inline_expr)),
-      prec.left(5, seq($._inline_expr, $._slash, $._inline_expr)),
-      prec.left(6, seq($._inline_expr, $._plus, $._inline_expr)),
-      prec.left(6, seq($._inline_expr, $._minus, $._inline_expr)),
-      prec.left(7, seq($._inline_expr, $._lshift, $._inline_expr)),
-      prec.left(7, seq($._inline_expr, $._rshift, $._inline_expr)),
-      prec.left(8, seq($._inline_expr, $._amp, $._inline_expr)),
-      prec.left(9, seq($._inline_expr, $._pipe, $._inline_expr)),
-      prec.left(10, seq($._inline_expr, $._eqeq, $._inline_expr)),
-      prec.left(10, seq($._inline_expr, $._neq, $._inline_expr)),
-      prec.left(10, seq($._inline_expr, $._lt, $._inline_expr)),
-      prec.left(10, seq($._inline_expr, $._gt, $._inline_expr)),
-      prec.left(10, seq($._inline_expr, $._lteq, $._inline_expr)),
-      prec.left(10, seq($._inline_expr, $._gteq, $._inline_expr)),
-      prec.left(11, seq($._inline_expr, $.kw_and, $._inline_expr)),
-      prec.left(12, seq($._inline_expr, $.kw_or, $._inline_expr)),
-    ),
-
-    is_expression: $ => prec.left(10, seq($._inline_expr, $.kw_is, $._pattern)),
-
-    return_expression: $ => prec.right(13, seq($.kw_return, optional($._inline_expr))),
-
-    return_block_expression: $ => seq($.kw_return, $._block_expr),
-
-    inline_lambda: $ => prec.right(0, seq(
-      $.backslash_lparen, sep($.lambda_param, $._comma), $.rparen,
-      optional($._return_type), $._colon, $._inline_expr,
-    )),
+      prec.left(5, seq(field('left', $._inline_expr), $._star, field('right', $._inline_expr))),
+      prec.left(5, seq(field('left', $._inline_expr), $._slash, field('right', $._inline_expr))),
+      prec.left(6, seq(field('left', $._inline_expr), $._plus, field('right', $._inline_expr))),
+      prec.left(6, seq(field('left', $._inline_expr), $._minus, field('right', $._inline_expr))),
+      prec.left(7, seq(field('left', $._inline_expr), $._lshift, field('right', $._inline_expr))),
+      prec.left(7, seq(field('left', $._inline_expr), $._rshift, field('right', $._inline_expr))),
+      prec.left(8, seq(field('left', $._inline_expr), $._amp, field('right', $._inline_expr))),
+      prec.left(9, seq(field('left', $._inline_expr), $._pipe, field('right', $._inline_expr))),
+      prec.left(10, seq(field('left', $._inline_expr), $._eqeq, field('right', $._inline_expr))),
+      prec.left(10, seq(field('left', $._inline_expr), $._neq, field('right', $._inline_expr))),
+      prec.left(10, seq(field('left', $._inline_expr), $._lt, field('right', $._inline_expr))),
+      prec.left(10, seq(field('left', $._inline_expr), $._gt, field('right', $._inline_expr))),
+      prec.left(10, seq(field('left', $._inline_expr), $._lteq, field('right', $._inline_expr))),
+      prec.left(10, seq(field('left', $._inline_expr), $._gteq, field('right', $._inline_expr))),
+      prec.left(11, seq(field('left', $._inline_expr), $.kw_and, field('right', $._inline_expr))),
+      prec.left(12, seq(field('left', $._inline_expr), $.kw_or, field('right', $._inline_expr))),
+    ),
+
+    is_expression: $ => prec.left(10, seq(field('value', $._inline_expr), $.kw_is, field('pattern', $._pattern))),
 
-    lambda_param: $ => seq($.lower_id, optional(seq($._colon, $._type))),
+    return_expression: $ => prec.right(13, seq($.kw_return, optional(field('value', $._inline_expr)))),
+
+    return_block_expression: $ => seq($.kw_return, field('value', $._block_expr)),
+
+    inline_lambda: $ => prec.right(0, seq($._lambda_head, field('body', $._inline_expr))),
+
+    // `\(params) ReturnType:`, shared by inline and block lambdas.
+    _lambda_head: $ => seq(
+      $.backslash_lparen, sep(field('params', $.lambda_param), $._comma), $.rparen,
+      optional(field('return_type', $._return_type)), $._colon,
+    ),
+
+    lambda_param: $ => seq(field('name', $.lower_id), optional(seq($._colon, field('type', $._type)))),
 
     call_argument: $ => choice(
-      seq($.lower_id, $._eq, $._expr),
-      $._expr,
+      seq(field('name', $.lower_id), $._eq, field('value', $._expr)),
+      field('value', $._expr),
     ),
 
     type_arguments: $ => seq($.lbracket, sep($._type, $._comma), $.rbracket),
@@ -478,34 +438,30 @@ module.exports = grammar({
     // Block expressions
 
     match_expression: $ => seq(
-      $.kw_match, $._inline_expr, $._colon,
+      $.kw_match, field('value', $._inline_expr), $._colon,
       $._start_block, repeat($.match_arm), $._end_block,
     ),
 
     match_arm: $ => choice(
-      seq($._pattern, $._colon, $._start_block, $.statements, $._end_block),
-      seq($._pattern, $.kw_if, $._expr, $._colon, $._start_block, $.statements, $._end_block),
-      seq($._pattern, $._colon, $._statement),
-      seq($._pattern, $.kw_if, $._expr, $._colon, $._statement),
+      seq(field('pattern', $._pattern), $._colon, $._start_block, field('body', $.statements), $._end_block),
+      seq(field('pattern', $._pattern), $.kw_if, field('guard', $._expr), $._colon, $._start_block, field('body', $.statements), $._end_block),
+      seq(field('pattern', $._pattern), $._colon, field('body', $._statement)),
+      seq(field('pattern', $._pattern), $.kw_if, field('guard', $._expr), $._colon, field('body', $._statement)),
     ),
 
     if_expression: $ => seq(
-      $.kw_if, $._expr, $._colon, $._start_block, $.statements, $._end_block,
+      $.kw_if, field('condition', $._expr), $._colon, $._start_block, field('body', $.statements), $._end_block,
       repeat($.elif_clause),
       optional($.else_clause),
     ),
 
-    elif_clause: $ => seq($.kw_elif, $._expr, $._colon, $._start_block, $.statements, $._end_block),
+    elif_clause: $ => seq($.kw_elif, field('condition', $._expr), $._colon, $._start_block, field('body', $.statements), $._end_block),
 
-    else_clause: $ => seq($.kw_else, $._colon, $._start_block, $.statements, $._end_block),
+    else_clause: $ => seq($.kw_else, $._colon, $._start_block, field('body', $.statements), $._end_block),
 
-    do_expression: $ => seq($.kw_do, $._colon, $._start_block, $.statements, $._end_block),
+    do_expression: $ => seq($.kw_do, $._colon, $._start_block, field('body', $.statements), $._end_block),
 
-    block_lambda: $ => seq(
-      $.backslash_lparen, sep($.lambda_param, $._comma), $.rparen,
-      optional($._return_type), $._colon,
-      $._start_block, $.statements, $._end_block,
-    ),
+    block_lambda: $ => seq($._lambda_head, $._start_block, field('body', $.statements), $._end_block),
 
     // ==================== Patterns ====================
 
@@ -523,11 +479,11 @@ module.exports = grammar({
 
     variable_pattern: $ => $.lower_id,
 
-    bare_constructor_pattern: $ => prec(-1, seq(...conPathParts($))),
+    bare_constructor_pattern: $ => prec(-1, $._con_path),
 
     constructor_pattern: $ => choice(
-      seq(...conPathParts($), $.lparen, $._field_pats, $.rparen),
-      seq(...conPathParts($), $.lparen, $.rparen),
+      seq($._con_path, $.lparen, $._field_pats, $.rparen),
+      seq($._con_path, $.lparen, $.rparen),
     ),
 
     record_pattern: $ => choice(
@@ -556,8 +512,8 @@ module.exports = grammar({
     ),
 
     field_pattern: $ => choice(
-      seq($.lower_id, $._eq, $._pattern),
-      $._pattern,
+      seq(field('name', $.lower_id), $._eq, field('pattern', $._pattern)),
+      field('pattern', $._pattern),
     ),
 
     // ==================== Import declarations ====================
@@ -570,8 +526,8 @@ module.exports = grammar({
     ),
 
     import_item: $ => seq(
-      $.import_path,
-      optional(seq($.kw_as, $.upper_id)),
+      field('path', $.import_path),
+      optional(seq($.kw_as, field('alias', $.upper_id))),
     ),
 
     // Path: UpperId ("/" UpperId)* optionally followed by "/*" or "/[names]"
@@ -587,16 +543,16 @@ module.exports = grammar({
     ),
 
     import_name: $ => choice(
-      seq($.lower_id, optional(seq($.kw_as, $.lower_id))),
-      seq($.upper_id, optional(seq($.kw_as, $.upper_id))),
+      seq(field('name', $.lower_id), optional(seq($.kw_as, field('alias', $.lower_id)))),
+      seq(field('name', $.upper_id), optional(seq($.kw_as, field('alias', $.upper_id)))),
     ),
 
     // ==================== Trait declarations ====================
 
     trait_declaration: $ => choice(
-      seq($.kw_trait, $.upper_id, $.lbracket, $.type_params, $._colon,
+      seq($.kw_trait, field('name', $.upper_id), $.lbracket, field('type_params', $.type_params), $._colon,
           $._start_block, repeat1($._trait_item), $._end_block),
-      seq($.kw_trait, $.upper_id, $.lbracket, $.type_params),
+      seq($.kw_trait, field('name', $.upper_id), $.lbracket, field('type_params', $.type_params)),
     ),
 
     _trait_item: $ => choice(
@@ -605,20 +561,20 @@ module.exports = grammar({
     ),
 
     trait_function_declaration: $ => choice(
-      seq($._fun_sig, $._colon, $._start_block, $.statements, $._end_block),
+      seq($._fun_sig, $._colon, $._start_block, field('body', $.statements), $._end_block),
       seq(optional($.kw_prim), $._fun_sig, $._newline),
-      seq($._fun_sig, $._colon, $._inline_expr, $._newline),
+      seq($._fun_sig, $._colon, field('body', $._inline_expr), $._newline),
     ),
 
     // Associated type declaration in trait: `type Item`, `type Item: Row[Rec]`, or `type Item = U32`
-    trait_type_declaration: $ => seq($.kw_type, $.upper_id, optional(seq($._colon, $._type)), optional(seq($._eq, $._type)), $._newline),
+    trait_type_declaration: $ => seq($.kw_type, field('name', $.upper_id), optional(seq($._colon, field('bound', $._type))), optional(seq($._eq, field('default', $._type))), $._newline),
 
     // ==================== Impl declarations ====================
 
     impl_declaration: $ => choice(
-      seq($.kw_impl, optional($.context), $.upper_id, $.lbracket, sep($._type, $._comma), $.rbracket, $._colon,
+      seq($.kw_impl, optional(field('context', $.context)), field('trait', $.upper_id), $.lbracket, sep($._type, $._comma), $.rbracket, $._colon,
           $._start_block, repeat1($._impl_item), $._end_block),
-      seq($.kw_impl, optional($.context), $.upper_id, $.lbracket, sep($._type, $._comma), $.rbracket),
+      seq($.kw_impl, optional(field('context', $.context)), field('trait', $.upper_id), $.lbracket, sep($._type, $._comma), $.rbracket),
     ),
 
     _impl_item: $ => choice(
@@ -627,12 +583,81 @@ module.exports = grammar({
     ),
 
     impl_function_declaration: $ => choice(
-      seq($._fun_sig, $._colon, $._start_block, $.statements, $._end_block),
+      seq($._fun_sig, $._colon, $._start_block, field('body', $.statements), $._end_block),
       seq(optional($.kw_prim), $._fun_sig, $._newline),
-      seq($._fun_sig, $._colon, $._inline_expr, $._newline),
+      seq($._fun_sig, $._colon, field('body', $._inline_expr), $._newline),
     ),
 
     // Associated type definition in impl: `type A = U64`
-    impl_type_declaration: $ => seq($.kw_type, $.upper_id, $._eq, $._type, $._newline),
+    impl_type_declaration: $ => seq($.kw_type, field('name', $.upper_id), $._eq, field('type', $._type), $._newline),
+
+    // ==================== Tokens ====================
+
+    upper_id: $ => /_*[A-Z][A-Za-z0-9_]*/,
+    lower_id: $ => /_*[a-z][A-Za-z0-9_]*/,
+
+    // Punctuation. Patterns rather than strings keep these out of the tree.
+    _colon: $ => /:/,
+    _comma: $ => /,/,
+    _dot: $ => /\./,
+    _dotdot: $ => /\.\./,
+    _eq: $ => /=/,
+    _underscore: $ => /_/,
+    _slash: $ => /\//,
+    _semicolon: $ => /;/,
+
+    // Operators
+    _plus: $ => /\+/,
+    _minus: $ => /-/,
+    _star: $ => /\*/,
+    _eqeq: $ => /==/,
+    _neq: $ => /!=/,
+    _lt: $ => /</,
+    _gt: $ => />/,
+    _lteq: $ => /<=/,
+    _gteq: $ => />=/,
+    _lshift: $ => /<</,
+    _rshift: $ => />>/,
+    _amp: $ => /&/,
+    _ampamp: $ => /&&/,
+    _pipe: $ => /\|/,
+    _tilde: $ => /~/,
+    _exclamation: $ => /!/,
+    _percent: $ => /%/,
+    _caret: $ => /\^/,
+    _pluseq: $ => /\+=/,
+    _minuseq: $ => /-=/,
+    _stareq: $ => /\*=/,
+    _careteq: $ => /\^=/,
+
+    // Keywords - named for highlighting
+    kw_and: $ => 'and',
+    kw_as: $ => 'as',
+    kw_break: $ => 'break',
+    kw_continue: $ => 'continue',
+    kw_do: $ => 'do',
+    kw_elif: $ => 'elif',
+    kw_else: $ => 'else',
+    kw_extern: $ => 'extern',
+    kw_fn: $ => 'fn',
+    kw_upper_fn: $ => 'Fn',
+    kw_for: $ => 'for',
+    kw_if: $ => 'if',
+    kw_impl: $ => 'impl',
+    kw_import: $ => 'import',
+    kw_in: $ => 'in',
+    kw_is: $ => 'is',
+    kw_let: $ => 'let',
+    kw_loop: $ => 'loop',
+    kw_match: $ => 'match',
+    kw_not: $ => 'not',
+    kw_or: $ => 'or',
+    kw_prim: $ => 'prim',
+    kw_return: $ => 'return',
+    kw_trait: $ => 'trait',
+    kw_type: $ => 'type',
+    kw_value: $ => 'value',
+    kw_while: $ => 'while',
+    kw_row: $ => 'row',
   },
 });
@@ -0,0 +1,243 @@
+#include "fir_highlight.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// More captures of one node than this (one per pattern that matches it) are
+// ignored when comparing.
+#define MAX_SPAN_CAPTURES 64
+
+typedef struct {
+    uint32_t start_byte;
+    uint32_t end_byte;
+    uint32_t capture;
+} Capture;
+
+typedef struct {
+    Capture *contents;
+    uint32_t size;
+    uint32_t capacity;
+} Captures;
+
+static void captures_push(Captures *captures, Capture capture) {
+    if (captures->size == captures->capacity) {
+        captures->capacity = captures->capacity ? captures->capacity * 2 : 64;
+        captures->contents = realloc(captures->contents, captures->capacity * sizeof(Capture));
+    }
+    captures->contents[captures->size++] = capture;
+}
+
+static int compare_captures(const void *a, const void *b) {
+    const Capture *x = a, *y = b;
+    if (x->start_byte != y->start_byte) return x->start_byte < y->start_byte ? -1 : 1;
+    if (x->end_byte != y->end_byte) return x->end_byte < y->end_byte ? -1 : 1;
+    if (x->capture != y->capture) return x->capture < y->capture ? -1 : 1;
+    return 0;
+}
+
+static bool same_span(const Capture *x, const Capture *y) {
+    return x->start_byte == y->start_byte && x->end_byte == y->end_byte;
+}
+
+// ==================== Ranges ====================
+
+// Extend `range` to the top-level nodes (children of the root) it overlaps.
+// Returns true if it changed.
+static bool widen(TSNode root, TSRange *range) {
+    bool changed = false;
+    TSNode first = ts_node_first_child_for_byte(root, range->start_byte);
+    if (!ts_node_is_null(first) && ts_node_start_byte(first) < range->start_byte) {
+        range->start_byte = ts_node_start_byte(first);
+        range->start_point = ts_node_start_point(first);
+        changed = true;
+    }
+    uint32_t last_byte = range->end_byte > range->start_byte ? range->end_byte - 1 : range->start_byte;
+    TSNode last = ts_node_first_child_for_byte(root, last_byte);
+    if (!ts_node_is_null(last) && ts_node_start_byte(last) <= last_byte && ts_node_end_byte(last) > range->end_byte) {
+        range->end_byte = ts_node_end_byte(last);
+        range->end_point = ts_node_end_point(last);
+        changed = true;
+    }
+    return changed;
+}
+
+// Move a position in the source before `edit` to the source after it. A
+// position in the replaced text moves to the start of the new text, or with
+// `to_end` to its end.
+static void edit_position(uint32_t *byte, TSPoint *point, const TSInputEdit *edit, bool to_end) {
+    if (*byte < edit->start_byte || (*byte == edit->start_byte && !to_end)) return;
+    if (*byte < edit->old_end_byte) {
+        *byte = to_end ? edit->new_end_byte : edit->start_byte;
+        *point = to_end ? edit->new_end_point : edit->start_point;
+        return;
+    }
+    *byte = *byte - edit->old_end_byte + edit->new_end_byte;
+    if (point->row == edit->old_end_point.row) {
+        point->column = point->column - edit->old_end_point.column + edit->new_end_point.column;
+    }
+    point->row = point->row - edit->old_end_point.row + edit->new_end_point.row;
+}
+
+// The new text of each edit, as a range in the source after all the edits.
+// Each edit is in the source after the ones before it, so its range is moved
+// through the ones after it.
+static void edited_ranges(const TSInputEdit *edits, uint32_t edit_count, TSRange *ranges) {
+    for (uint32_t i = 0; i < edit_count; i++) {
+        TSRange *range = &ranges[i];
+        *range = (TSRange){edits[i].start_point, edits[i].new_end_point, edits[i].start_byte, edits[i].new_end_byte};
+        for (uint32_t j = i + 1; j < edit_count; j++) {
+            edit_position(&range->start_byte, &range->start_point, &edits[j], false);
+            edit_position(&range->end_byte, &range->end_point, &edits[j], true);
+        }
+    }
+}
+
+static int compare_ranges(const void *a, const void *b) {
+    const TSRange *x = a, *y = b;
+    return x->start_byte < y->start_byte ? -1 : x->start_byte > y->start_byte;
+}
+
+// Widen the ranges in both trees (a declaration can be split or joined by the
+// edit, so the old and new declarations can differ), then sort and merge them.
+// Returns the new number of ranges.
+static uint32_t widen_ranges(TSNode old_root, TSNode new_root, TSRange *ranges, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        bool changed = true;
+        while (changed) {
+            changed = widen(new_root, &ranges[i]);
+            changed |= widen(old_root, &ranges[i]);
+        }
+    }
+    qsort(ranges, count, sizeof(TSRange), compare_ranges);
+    uint32_t merged = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (merged > 0 && ranges[i].start_byte <= ranges[merged - 1].end_byte) {
+            if (ranges[i].end_byte > ranges[merged - 1].end_byte) {
+                ranges[merged - 1].end_byte = ranges[i].end_byte;
+                ranges[merged - 1].end_point = ranges[i].end_point;
+            }
+        } else {
+            ranges[merged++] = ranges[i];
+        }
+    }
+    return merged;
+}
+
+// ==================== Delta ====================
+
+static void collect(const TSQuery *query, TSQueryCursor *cursor, const TSTree *tree, const TSRange *ranges,
+                    uint32_t range_count, Captures *captures) {
+    for (uint32_t r = 0; r < range_count; r++) {
+        ts_query_cursor_set_byte_range(cursor, ranges[r].start_byte, ranges[r].end_byte);
+        ts_query_cursor_exec(cursor, query, ts_tree_root_node(tree));
+        TSQueryMatch match;
+        uint32_t capture_index;
+        while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
+            TSNode node = match.captures[capture_index].node;
+            Capture capture = {ts_node_start_byte(node), ts_node_end_byte(node), match.captures[capture_index].index};
+            // Nodes that reach outside the range (e.g. a capture on the whole
+            // file) are the same in both trees.
+            if (capture.start_byte < ranges[r].start_byte || capture.end_byte > ranges[r].end_byte) continue;
+            captures_push(captures, capture);
+        }
+    }
+    qsort(captures->contents, captures->size, sizeof(Capture), compare_captures);
+}
+
+static void push_change(FirHighlightDelta *delta, uint32_t *capacity, FirHighlightChange change) {
+    if (delta->change_count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        delta->changes = realloc(delta->changes, *capacity * sizeof(FirHighlightChange));
+    }
+    delta->changes[delta->change_count++] = change;
+}
+
+// Compare the captures of one span: captures in both are unchanged, and the
+// rest are paired up as CHANGED, with the leftovers ADDED or REMOVED.
+static void diff_span(FirHighlightDelta *delta, uint32_t *capacity, const Capture *old, uint32_t old_count,
+                      const Capture *new, uint32_t new_count) {
+    uint32_t i = 0, j = 0;
+    const Capture *removed[MAX_SPAN_CAPTURES], *added[MAX_SPAN_CAPTURES];
+    uint32_t removed_count = 0, added_count = 0;
+    while (i < old_count || j < new_count) {
+        int order = i == old_count ? 1 : j == new_count ? -1 : compare_captures(&old[i], &new[j]);
+        if (order == 0) {
+            i++;
+            j++;
+        } else if (order < 0) {
+            if (removed_count < MAX_SPAN_CAPTURES) removed[removed_count++] = &old[i];
+            i++;
+        } else {
+            if (added_count < MAX_SPAN_CAPTURES) added[added_count++] = &new[j];
+            j++;
+        }
+    }
+    uint32_t paired = removed_count < added_count ? removed_count : added_count;
+    for (uint32_t k = 0; k < paired; k++) {
+        push_change(delta, capacity, (FirHighlightChange){
+            FIR_HIGHLIGHT_CHANGED, added[k]->start_byte, added[k]->end_byte, added[k]->capture, removed[k]->capture,
+        });
+    }
+    for (uint32_t k = paired; k < removed_count; k++) {
+        push_change(delta, capacity, (FirHighlightChange){
+            FIR_HIGHLIGHT_REMOVED, removed[k]->start_byte, removed[k]->end_byte, removed[k]->capture, 0,
+        });
+    }
+    for (uint32_t k = paired; k < added_count; k++) {
+        push_change(delta, capacity, (FirHighlightChange){
+            FIR_HIGHLIGHT_ADDED, added[k]->start_byte, added[k]->end_byte, added[k]->capture, 0,
+        });
+    }
+}
+
+void fir_highlight_delta(const TSQuery *query, TSQueryCursor *cursor, const TSTree *old_tree,
+                         const TSTree *new_tree, const TSInputEdit *edits, uint32_t edit_count,
+                         FirHighlightDelta *delta) {
+    *delta = (FirHighlightDelta){0};
+    uint32_t changed_count;
+    TSRange *changed = ts_tree_get_changed_ranges(old_tree, new_tree, &changed_count);
+    uint32_t range_count = changed_count + edit_count;
+    TSRange *ranges = malloc((range_count ? range_count : 1) * sizeof(TSRange));
+    if (changed_count) memcpy(ranges, changed, changed_count * sizeof(TSRange));
+    free(changed);
+    edited_ranges(edits, edit_count, ranges + changed_count);
+    range_count = widen_ranges(ts_tree_root_node(old_tree), ts_tree_root_node(new_tree), ranges, range_count);
+    delta->ranges = ranges;
+    delta->range_count = range_count;
+    if (range_count == 0) return;
+
+    Captures old = {0}, new = {0};
+    collect(query, cursor, old_tree, ranges, range_count, &old);
+    collect(query, cursor, new_tree, ranges, range_count, &new);
+    ts_query_cursor_set_byte_range(cursor, 0, UINT32_MAX);
+
+    // Walk both lists one span at a time.
+    uint32_t capacity = 0;
+    uint32_t i = 0, j = 0;
+    while (i < old.size || j < new.size) {
+        const Capture *span;
+        if (i == old.size) {
+            span = &new.contents[j];
+        } else if (j == new.size) {
+            span = &old.contents[i];
+        } else {
+            int order = compare_captures(&old.contents[i], &new.contents[j]);
+            span = order <= 0 ? &old.contents[i] : &new.contents[j];
+        }
+        uint32_t old_end = i, new_end = j;
+        while (old_end < old.size && same_span(&old.contents[old_end], span)) old_end++;
+        while (new_end < new.size && same_span(&new.contents[new_end], span)) new_end++;
+        diff_span(delta, &capacity, &old.contents[i], old_end - i, &new.contents[j], new_end - j);
+        i = old_end;
+        j = new_end;
+    }
+
+    free(old.contents);
+    free(new.contents);
+}
+
+void fir_highlight_delta_delete(FirHighlightDelta *delta) {
+    free(delta->changes);
+    free(delta->ranges);
+    *delta = (FirHighlightDelta){0};
+}
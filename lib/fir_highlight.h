@@ -0,0 +1,59 @@
+// Updating highlights after an incremental reparse.
+//
+// Instead of running the highlights query over the whole file (or viewport)
+// after every edit, `fir_highlight_delta` runs it only on the top-level
+// declarations that contain the edits or the ranges `ts_tree_get_changed_ranges`
+// reports, in the old and the new tree, and returns the captures that differ. The cost
+// of an update scales with the size of the edited declarations instead of the
+// file.
+
+#ifndef FIR_HIGHLIGHT_H_
+#define FIR_HIGHLIGHT_H_
+
+#include <tree_sitter/api.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    FIR_HIGHLIGHT_ADDED,
+    FIR_HIGHLIGHT_REMOVED,
+    FIR_HIGHLIGHT_CHANGED,  // same span, different capture
+} FirHighlightChangeKind;
+
+typedef struct {
+    FirHighlightChangeKind kind;
+    uint32_t start_byte;
+    uint32_t end_byte;
+    uint32_t capture;      // capture id in the query; for REMOVED, the old one
+    uint32_t old_capture;  // for CHANGED
+} FirHighlightChange;
+
+typedef struct {
+    // Ordered by position.
+    FirHighlightChange *changes;
+    uint32_t change_count;
+    // The ranges that were highlighted again: the edited and changed ranges
+    // widened to whole top-level declarations, ordered and disjoint.
+    TSRange *ranges;
+    uint32_t range_count;
+} FirHighlightDelta;
+
+// Compute the highlight changes between `old_tree`, which must have been
+// edited with `ts_tree_edit` to match the new source (as for an incremental
+// reparse), and `new_tree`. `edits` are the `edit_count` edits passed to
+// `ts_tree_edit`, in order. Positions are in the new source.
+//
+// The edits are needed because `ts_tree_get_changed_ranges` only reports
+// changes in the structure of the tree, and renaming an identifier keeps the
+// shape. Captures are compared by node span and capture id; like any query
+// cursor, text predicates (`#eq?`, `#match?`) aren't applied, so a caller that
+// applies them re-checks the captures in `ranges`, which include the edited
+// text. `cursor` is reset to the whole tree afterwards.
+void fir_highlight_delta(const TSQuery *query, TSQueryCursor *cursor, const TSTree *old_tree,
+                         const TSTree *new_tree, const TSInputEdit *edits, uint32_t edit_count,
+                         FirHighlightDelta *delta);
+
+void fir_highlight_delta_delete(FirHighlightDelta *delta);
+
+#endif // FIR_HIGHLIGHT_H_
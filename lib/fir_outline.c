@@ -0,0 +1,163 @@
+#include "fir_outline.h"
+
+#include <string.h>
+
+typedef enum {
+    SYMBOL_FUNCTION_DECLARATION,
+    SYMBOL_TYPE_DECLARATION,
+    SYMBOL_TRAIT_DECLARATION,
+    SYMBOL_IMPL_DECLARATION,
+    SYMBOL_TRAIT_FUNCTION_DECLARATION,
+    SYMBOL_IMPL_FUNCTION_DECLARATION,
+    SYMBOL_TRAIT_TYPE_DECLARATION,
+    SYMBOL_IMPL_TYPE_DECLARATION,
+    SYMBOL_CONSTRUCTOR_LIST,
+    SYMBOL_CONSTRUCTOR_DECLARATION,
+    SYMBOL_FUN_SIG,
+    SYMBOL_PARENT_TYPE,
+    SYMBOL_UPPER_ID,
+    SYMBOL_RBRACKET,
+    SYMBOL_COUNT,
+} Symbol;
+
+static const char *const symbol_names[SYMBOL_COUNT] = {
+    [SYMBOL_FUNCTION_DECLARATION] = "function_declaration",
+    [SYMBOL_TYPE_DECLARATION] = "type_declaration",
+    [SYMBOL_TRAIT_DECLARATION] = "trait_declaration",
+    [SYMBOL_IMPL_DECLARATION] = "impl_declaration",
+    [SYMBOL_TRAIT_FUNCTION_DECLARATION] = "trait_function_declaration",
+    [SYMBOL_IMPL_FUNCTION_DECLARATION] = "impl_function_declaration",
+    [SYMBOL_TRAIT_TYPE_DECLARATION] = "trait_type_declaration",
+    [SYMBOL_IMPL_TYPE_DECLARATION] = "impl_type_declaration",
+    [SYMBOL_CONSTRUCTOR_LIST] = "constructor_list",
+    [SYMBOL_CONSTRUCTOR_DECLARATION] = "constructor_declaration",
+    [SYMBOL_FUN_SIG] = "fun_sig",
+    [SYMBOL_PARENT_TYPE] = "parent_type",
+    [SYMBOL_UPPER_ID] = "upper_id",
+    [SYMBOL_RBRACKET] = "rbracket",
+};
+
+typedef struct {
+    TSSymbol symbols[SYMBOL_COUNT];
+    TSTreeCursor cursor;
+    FirOutlineEntry *entries;
+    uint32_t capacity;
+    uint32_t count;
+} Outline;
+
+static uint32_t push(Outline *outline, FirOutlineKind kind, uint32_t parent, TSNode node, uint32_t name_start,
+                     uint32_t name_end) {
+    if (outline->count < outline->capacity) {
+        outline->entries[outline->count] = (FirOutlineEntry){
+            .kind = kind,
+            .parent = parent,
+            .start_byte = ts_node_start_byte(node),
+            .end_byte = ts_node_end_byte(node),
+            .name_start_byte = name_start,
+            .name_end_byte = name_end,
+            .start_row = ts_node_start_point(node).row,
+            .end_row = ts_node_end_point(node).row,
+        };
+    }
+    return outline->count++;
+}
+
+// The first child of the cursor's node with symbol `symbol`, or a null node.
+// Only looks at the direct children, and leaves the cursor where it was.
+static TSNode find_child(Outline *outline, Symbol symbol) {
+    TSNode result = {0};
+    TSTreeCursor *cursor = &outline->cursor;
+    if (!ts_tree_cursor_goto_first_child(cursor)) return result;
+    do {
+        TSNode node = ts_tree_cursor_current_node(cursor);
+        if (ts_node_symbol(node) == outline->symbols[symbol]) {
+            result = node;
+            break;
+        }
+    } while (ts_tree_cursor_goto_next_sibling(cursor));
+    ts_tree_cursor_goto_parent(cursor);
+    return result;
+}
+
+// The name of a function is the first child of its `fun_sig`, preceded by the
+// parent type if it has one.
+static void add_function(Outline *outline, FirOutlineKind kind, uint32_t parent) {
+    TSNode node = ts_tree_cursor_current_node(&outline->cursor);
+    TSNode sig = find_child(outline, SYMBOL_FUN_SIG);
+    if (ts_node_is_null(sig) || ts_node_child_count(sig) == 0) return;
+    TSNode name = ts_node_child(sig, 0);
+    uint32_t name_start = ts_node_start_byte(name);
+    if (kind == FIR_OUTLINE_FUNCTION) {
+        TSNode parent_type = find_child(outline, SYMBOL_PARENT_TYPE);
+        if (!ts_node_is_null(parent_type)) name_start = ts_node_start_byte(parent_type);
+    }
+    push(outline, kind, parent, node, name_start, ts_node_end_byte(name));
+}
+
+// Declarations named by their first `upper_id`.
+static uint32_t add_named(Outline *outline, FirOutlineKind kind, uint32_t parent) {
+    TSNode node = ts_tree_cursor_current_node(&outline->cursor);
+    TSNode name = find_child(outline, SYMBOL_UPPER_ID);
+    if (ts_node_is_null(name)) name = node;
+    uint32_t name_end = ts_node_end_byte(name);
+    // An impl's name runs to the `]` of the trait's arguments. A context has
+    // its own brackets, but they aren't direct children.
+    if (kind == FIR_OUTLINE_IMPL) {
+        TSNode rbracket = find_child(outline, SYMBOL_RBRACKET);
+        if (!ts_node_is_null(rbracket)) name_end = ts_node_end_byte(rbracket);
+    }
+    return push(outline, kind, parent, node, ts_node_start_byte(name), name_end);
+}
+
+// Add the items of the cursor's node: the constructors of a type, and the
+// functions and types of a trait or impl. Other children (bodies, types,
+// expressions) are skipped without entering them.
+static void add_items(Outline *outline, uint32_t parent) {
+    const TSSymbol *symbols = outline->symbols;
+    TSTreeCursor *cursor = &outline->cursor;
+    if (!ts_tree_cursor_goto_first_child(cursor)) return;
+    do {
+        TSSymbol symbol = ts_node_symbol(ts_tree_cursor_current_node(cursor));
+        if (symbol == symbols[SYMBOL_TRAIT_FUNCTION_DECLARATION] ||
+            symbol == symbols[SYMBOL_IMPL_FUNCTION_DECLARATION]) {
+            add_function(outline, FIR_OUTLINE_METHOD, parent);
+        } else if (symbol == symbols[SYMBOL_TRAIT_TYPE_DECLARATION] ||
+                   symbol == symbols[SYMBOL_IMPL_TYPE_DECLARATION]) {
+            add_named(outline, FIR_OUTLINE_ASSOCIATED_TYPE, parent);
+        } else if (symbol == symbols[SYMBOL_CONSTRUCTOR_DECLARATION]) {
+            add_named(outline, FIR_OUTLINE_CONSTRUCTOR, parent);
+        } else if (symbol == symbols[SYMBOL_CONSTRUCTOR_LIST]) {
+            add_items(outline, parent);
+        }
+    } while (ts_tree_cursor_goto_next_sibling(cursor));
+    ts_tree_cursor_goto_parent(cursor);
+}
+
+uint32_t fir_outline(const TSTree *tree, FirOutlineEntry *entries, uint32_t capacity) {
+    const TSLanguage *language = ts_tree_language(tree);
+    Outline outline = {.entries = entries, .capacity = capacity};
+    for (int i = 0; i < SYMBOL_COUNT; i++) {
+        outline.symbols[i] = ts_language_symbol_for_name(language, symbol_names[i],
+                                                         (uint32_t)strlen(symbol_names[i]), true);
+    }
+    const TSSymbol *symbols = outline.symbols;
+
+    outline.cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    TSTreeCursor *cursor = &outline.cursor;
+    if (ts_tree_cursor_goto_first_child(cursor)) {
+        do {
+            TSSymbol symbol = ts_node_symbol(ts_tree_cursor_current_node(cursor));
+            if (symbol == symbols[SYMBOL_FUNCTION_DECLARATION]) {
+                add_function(&outline, FIR_OUTLINE_FUNCTION, FIR_OUTLINE_NO_PARENT);
+            } else if (symbol == symbols[SYMBOL_TYPE_DECLARATION]) {
+                add_items(&outline, add_named(&outline, FIR_OUTLINE_TYPE, FIR_OUTLINE_NO_PARENT));
+            } else if (symbol == symbols[SYMBOL_TRAIT_DECLARATION]) {
+                add_items(&outline, add_named(&outline, FIR_OUTLINE_TRAIT, FIR_OUTLINE_NO_PARENT));
+            } else if (symbol == symbols[SYMBOL_IMPL_DECLARATION]) {
+                add_items(&outline, add_named(&outline, FIR_OUTLINE_IMPL, FIR_OUTLINE_NO_PARENT));
+            }
+        } while (ts_tree_cursor_goto_next_sibling(cursor));
+    }
+    ts_tree_cursor_delete(cursor);
+    return outline.count;
+}
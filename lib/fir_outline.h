@@ -0,0 +1,50 @@
+// A flat outline of a file's declarations, for symbol search and indexing.
+//
+// `fir_outline` walks the top levels of a tree once with a tree cursor and
+// writes one fixed-size record per declaration into a buffer from the caller:
+// top-level functions, types and their constructors, traits and impls and
+// their items. It doesn't enter function bodies or other expressions, and
+// doesn't allocate (apart from the cursor), so indexing a file costs one
+// shallow pass over its tree.
+
+#ifndef FIR_OUTLINE_H_
+#define FIR_OUTLINE_H_
+
+#include <tree_sitter/api.h>
+
+#include <stdint.h>
+
+typedef enum {
+    FIR_OUTLINE_FUNCTION,
+    FIR_OUTLINE_TYPE,
+    FIR_OUTLINE_CONSTRUCTOR,
+    FIR_OUTLINE_TRAIT,
+    FIR_OUTLINE_IMPL,
+    FIR_OUTLINE_METHOD,           // a function in a trait or impl
+    FIR_OUTLINE_ASSOCIATED_TYPE,  // a type in a trait or impl
+} FirOutlineKind;
+
+#define FIR_OUTLINE_NO_PARENT UINT32_MAX
+
+// The bindings mirror this layout; keep it fixed-size and without padding.
+typedef struct {
+    uint32_t kind;    // FirOutlineKind
+    uint32_t parent;  // the index of the enclosing trait, impl or type, or FIR_OUTLINE_NO_PARENT
+    uint32_t start_byte;
+    uint32_t end_byte;
+    // The name in the source: `push` for a method, `Vec.push` for a function
+    // with a parent type, `ToStr[U32]` for an impl.
+    uint32_t name_start_byte;
+    uint32_t name_end_byte;
+    uint32_t start_row;
+    uint32_t end_row;
+} FirOutlineEntry;
+
+// Write the outline of `tree` to `entries`, which has room for `capacity`
+// entries, in document order (a parent before its items). Returns the number
+// of entries in the outline. If that's more than `capacity`, only the first
+// `capacity` were written, and the call can be repeated with a larger buffer.
+// Declarations inside ERROR nodes are skipped.
+uint32_t fir_outline(const TSTree *tree, FirOutlineEntry *entries, uint32_t capacity);
+
+#endif // FIR_OUTLINE_H_
@@ -0,0 +1,111 @@
+#include "fir_parallel.h"
+#include "fir_stream.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define DEFAULT_MIN_CHUNK_BYTES (64 * 1024)
+
+// Chunks per thread, so that threads that get the faster chunks can take more.
+#define CHUNKS_PER_JOB 4
+
+typedef struct {
+    const TSLanguage *language;
+    const char *source;
+    uint32_t length;
+    FirChunk *chunks;
+    uint32_t count;
+    atomic_uint next_chunk;
+} Job;
+
+static void parse_chunk(TSParser *parser, const char *source, uint32_t length, FirChunk *chunk) {
+    ts_parser_set_included_ranges(parser, &chunk->range, 1);
+    chunk->tree = ts_parser_parse_string(parser, NULL, source, length);
+}
+
+static void *worker(void *arg) {
+    Job *job = arg;
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, job->language);
+
+    uint32_t i;
+    while ((i = atomic_fetch_add(&job->next_chunk, 1)) < job->count) {
+        parse_chunk(parser, job->source, job->length, &job->chunks[i]);
+    }
+
+    ts_parser_delete(parser);
+    return NULL;
+}
+
+// Group the declarations into chunks of at least `chunk_bytes`.
+static uint32_t split(const char *source, uint32_t length, uint32_t chunk_bytes, FirChunk **chunks) {
+    uint32_t count = 0, capacity = 0;
+    *chunks = NULL;
+    TSRange range = {0};
+    while (fir_next_declaration(source, length, &range)) {
+        TSRange *last = count > 0 ? &(*chunks)[count - 1].range : NULL;
+        if (last && last->end_byte - last->start_byte < chunk_bytes) {
+            last->end_byte = range.end_byte;
+            last->end_point = range.end_point;
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            *chunks = realloc(*chunks, capacity * sizeof(FirChunk));
+        }
+        (*chunks)[count++] = (FirChunk){NULL, range};
+    }
+    return count;
+}
+
+uint32_t fir_parse_parallel(const TSLanguage *language, const char *source, uint32_t length,
+                            uint32_t jobs, uint32_t min_chunk_bytes, FirChunk **chunks) {
+    if (jobs == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    if (min_chunk_bytes == 0) min_chunk_bytes = DEFAULT_MIN_CHUNK_BYTES;
+
+    uint32_t chunk_bytes = length / (jobs * CHUNKS_PER_JOB);
+    if (chunk_bytes < min_chunk_bytes) chunk_bytes = min_chunk_bytes;
+    uint32_t count = split(source, length, chunk_bytes, chunks);
+    if (count == 0) return 0;
+
+    Job job = {
+        .language = language,
+        .source = source,
+        .length = length,
+        .chunks = *chunks,
+        .count = count,
+    };
+    atomic_init(&job.next_chunk, 0);
+
+    if (jobs > count) jobs = count;
+    if (jobs == 1) {
+        worker(&job);
+        return count;
+    }
+
+    // The calling thread is one of the workers. If a thread can't be started,
+    // the threads that did start and the calling thread take its chunks.
+    pthread_t *threads = malloc((jobs - 1) * sizeof(pthread_t));
+    uint32_t started = 0;
+    while (threads && started < jobs - 1 && pthread_create(&threads[started], NULL, worker, &job) == 0) {
+        started++;
+    }
+    worker(&job);
+    for (uint32_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+    return count;
+}
+
+void fir_chunks_delete(FirChunk *chunks, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (chunks[i].tree) ts_tree_delete(chunks[i].tree);
+    }
+    free(chunks);
+}
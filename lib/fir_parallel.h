@@ -0,0 +1,34 @@
+// Parsing one Fir file on several threads.
+//
+// The file is split at top-level declaration boundaries (`fir_next_declaration`
+// in fir_stream.h), where the scanner is in its initial state. Consecutive
+// declarations are grouped into chunks of similar size, and the chunks are
+// parsed on a pool of threads, each with its own parser, using included
+// ranges. The result is one tree per chunk, in file order: tree-sitter can't
+// join trees, but the nodes in each tree have positions in the whole file, so
+// together they cover the file like the children of its `source_file` node.
+
+#ifndef FIR_PARALLEL_H_
+#define FIR_PARALLEL_H_
+
+#include <tree_sitter/api.h>
+
+#include <stdint.h>
+
+typedef struct {
+    TSTree *tree;
+    TSRange range;
+} FirChunk;
+
+// Parse `source` on `jobs` threads (0: the number of CPUs). Chunks are at least
+// `min_chunk_bytes` long (0: 64 KB), so small files are parsed as one chunk on
+// the calling thread, as are all the chunks if no thread can be started.
+// Stores the chunks in `*chunks`, to be freed with `fir_chunks_delete`, and
+// returns their number.
+uint32_t fir_parse_parallel(const TSLanguage *language, const char *source, uint32_t length,
+                            uint32_t jobs, uint32_t min_chunk_bytes, FirChunk **chunks);
+
+// Delete the chunks' trees and the array.
+void fir_chunks_delete(FirChunk *chunks, uint32_t count);
+
+#endif // FIR_PARALLEL_H_
@@ -0,0 +1,196 @@
+#include "fir_stream.h"
+
+#include <stddef.h>
+
+// Deeper nesting than this stops the splitting: the rest of the file is parsed
+// as one declaration.
+#define MAX_NESTING 256
+
+typedef struct {
+    const char *source;
+    uint32_t length;
+    uint32_t pos;
+    uint32_t row;
+    uint32_t line_start;
+} Splitter;
+
+static void next_char(Splitter *s) {
+    if (s->source[s->pos] == '\n') {
+        s->row++;
+        s->line_start = s->pos + 1;
+    }
+    s->pos++;
+}
+
+static char peek(const Splitter *s, uint32_t offset) {
+    return s->pos + offset < s->length ? s->source[s->pos + offset] : '\0';
+}
+
+// Length of the UTF-8 character starting with byte `c`.
+static uint32_t utf8_length(unsigned char c) {
+    if (c >= 0xF0) return 4;
+    if (c >= 0xE0) return 3;
+    if (c >= 0xC0) return 2;
+    return 1;
+}
+
+// Skip a block comment, which can be nested. Assumes pos is at `#|`.
+static void skip_block_comment(Splitter *s) {
+    s->pos += 2;
+    int depth = 1;
+    while (depth > 0 && s->pos < s->length) {
+        if (peek(s, 0) == '#' && peek(s, 1) == '|') {
+            s->pos += 2;
+            depth++;
+        } else if (peek(s, 0) == '|' && peek(s, 1) == '#') {
+            s->pos += 2;
+            depth--;
+        } else {
+            next_char(s);
+        }
+    }
+}
+
+// Skip a character literal (e.g. '"', '\'', 'é') or the quote of a label
+// ('outer). Assumes pos is at the quote.
+static void skip_quote(Splitter *s) {
+    uint32_t end = s->pos + 1;
+    if (end < s->length && s->source[end] == '\\') {
+        end += 2;
+    } else if (end < s->length) {
+        end += utf8_length((unsigned char)s->source[end]);
+    }
+    if (end < s->length && s->source[end] == '\'') {
+        s->pos = end + 1;
+    } else {
+        s->pos++;
+    }
+}
+
+bool fir_next_declaration(const char *source, uint32_t length, TSRange *range) {
+    if (range->end_byte >= length) return false;
+
+    Splitter s = {source, length, range->end_byte, range->end_point.row, range->end_byte};
+
+    // Open strings, interpolations and brackets: '"', '`', or the opening
+    // bracket.
+    char stack[MAX_NESTING];
+    uint32_t depth = 0;
+
+    // Whether the line at column 0 that starts the declaration was seen.
+    bool seen_declaration = false;
+
+    // Start of the comment and attribute lines at column 0 right before the
+    // current line, which belong to the next declaration.
+    bool in_comments = false;
+    uint32_t comments_byte = 0;
+    uint32_t comments_row = 0;
+
+    bool at_line_start = true;
+    while (s.pos < length) {
+        char c = source[s.pos];
+
+        if (at_line_start && depth == 0) {
+            at_line_start = false;
+            if (c == '#') {
+                if (!in_comments) {
+                    in_comments = true;
+                    comments_byte = s.pos;
+                    comments_row = s.row;
+                }
+            } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                // Indented or empty line: the comments before it aren't
+                // attached to a declaration.
+                in_comments = false;
+            } else if (!seen_declaration) {
+                seen_declaration = true;
+                in_comments = false;
+            } else {
+                uint32_t end_byte = in_comments ? comments_byte : s.pos;
+                uint32_t end_row = in_comments ? comments_row : s.row;
+                range->start_byte = range->end_byte;
+                range->start_point = range->end_point;
+                range->end_byte = end_byte;
+                range->end_point = (TSPoint){end_row, 0};
+                return true;
+            }
+        }
+
+        char top = depth > 0 ? stack[depth - 1] : '\0';
+        if (top == '"') {
+            // In a string
+            if (c == '\\') {
+                s.pos++;
+                if (s.pos < length) next_char(&s);
+                continue;
+            }
+            if (c == '"') {
+                depth--;
+            } else if (c == '`') {
+                if (depth == MAX_NESTING) goto rest_of_file;
+                stack[depth++] = '`';
+            }
+            next_char(&s);
+            continue;
+        }
+
+        switch (c) {
+            case '\n':
+                next_char(&s);
+                at_line_start = true;
+                continue;
+            case '#':
+                if (peek(&s, 1) == '|') {
+                    skip_block_comment(&s);
+                } else {
+                    while (s.pos < length && source[s.pos] != '\n') s.pos++;
+                }
+                continue;
+            case '\'':
+                skip_quote(&s);
+                continue;
+            case '"':
+            case '(':
+            case '[':
+            case '{':
+                if (depth == MAX_NESTING) goto rest_of_file;
+                stack[depth++] = c;
+                break;
+            case ')':
+            case ']':
+            case '}':
+                if (top != '\0' && top != '`') depth--;
+                break;
+            case '`':
+                // End of an interpolation, back in the string
+                if (top == '`') depth--;
+                break;
+        }
+        next_char(&s);
+    }
+
+rest_of_file:
+    while (s.pos < length) next_char(&s);
+    range->start_byte = range->end_byte;
+    range->start_point = range->end_point;
+    range->end_byte = length;
+    range->end_point = (TSPoint){s.row, length - s.line_start};
+    return true;
+}
+
+uint32_t fir_parse_declarations(TSParser *parser, const char *source, uint32_t length,
+                                FirDeclarationCallback callback, void *payload) {
+    TSRange range = {0};
+    uint32_t count = 0;
+    while (fir_next_declaration(source, length, &range)) {
+        ts_parser_set_included_ranges(parser, &range, 1);
+        TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+        if (tree == NULL) break;
+        count++;
+        bool keep_going = callback(tree, range, payload);
+        ts_tree_delete(tree);
+        if (!keep_going) break;
+    }
+    ts_parser_set_included_ranges(parser, NULL, 0);
+    return count;
+}
@@ -0,0 +1,39 @@
+// Parsing a Fir file one top-level declaration at a time.
+//
+// Top-level declarations start at column 0, and the scanner is in its initial
+// state (one layout frame at column 0) at the start of each of them. So a file
+// can be split at the lines that start at column 0 outside of strings, comments
+// and brackets, and each part parsed on its own with included ranges. Only one
+// declaration's tree is alive at a time, so memory use is bounded by the largest
+// declaration instead of the file.
+
+#ifndef FIR_STREAM_H_
+#define FIR_STREAM_H_
+
+#include <tree_sitter/api.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Find the next declaration in `source` after `range`, which is updated to the
+// declaration's range. Start with a zeroed range. Returns false at the end of
+// the file.
+//
+// A declaration's range reaches to the start of the next one, and includes the
+// comment lines at column 0 right before it, e.g. its doc comments and
+// attributes. The ranges cover the whole file.
+bool fir_next_declaration(const char *source, uint32_t length, TSRange *range);
+
+// Called with the tree of each declaration. Nodes in the tree have positions in
+// the whole file. The tree is deleted after the callback returns; return false
+// to stop.
+typedef bool (*FirDeclarationCallback)(const TSTree *tree, TSRange range, void *payload);
+
+// Parse the declarations in `source` one at a time with `parser`, which must
+// have the Fir language set, and call `callback` with each one's tree. Returns
+// the number of declarations parsed. The parser's included ranges are reset
+// afterwards.
+uint32_t fir_parse_declarations(TSParser *parser, const char *source, uint32_t length,
+                                FirDeclarationCallback callback, void *payload);
+
+#endif // FIR_STREAM_H_
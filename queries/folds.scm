@@ -0,0 +1,48 @@
+; Fold ranges, with the @fold capture of nvim-treesitter and Zed.
+;
+; A captured node folds the lines after its first. Blocks are anchored on the
+; `statements` (or `constructor_list`) node between the scanner's START_BLOCK
+; and END_BLOCK, so declarations with an inline body aren't folds.
+
+; ==================== Declarations ====================
+
+(function_declaration (statements)) @fold
+(trait_function_declaration (statements)) @fold
+(impl_function_declaration (statements)) @fold
+
+(type_declaration (constructor_list)) @fold
+
+; A trait or impl without items has no body. Anchored on the last item, so
+; each declaration matches once.
+(trait_declaration
+  [
+    (trait_function_declaration)
+    (trait_type_declaration)
+  ] .) @fold
+
+(impl_declaration
+  [
+    (impl_function_declaration)
+    (impl_type_declaration)
+  ] .) @fold
+
+(import_declaration) @fold
+
+; ==================== Statements and expressions ====================
+
+(for_statement (statements)) @fold
+(while_statement (statements)) @fold
+(loop_statement (statements)) @fold
+(do_expression (statements)) @fold
+(block_lambda (statements)) @fold
+
+(if_expression (statements)) @fold
+(elif_clause) @fold
+(else_clause) @fold
+
+(match_expression) @fold
+(match_arm (statements)) @fold
+
+; ==================== Comments ====================
+
+(block_comment) @fold
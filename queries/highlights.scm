@@ -34,19 +34,20 @@
 
 (int_literal) @number
 
-(char_literal) @string
-
-(string_expression) @string
-
-(string_content) @string
+[
+  (char_literal)
+  (string_expression)
+  (string_content)
+] @string
 
 (string_interpolation) @embedded
 
 ; ==================== Comments ====================
 
-(line_comment) @comment
-
-(block_comment) @comment
+[
+  (line_comment)
+  (block_comment)
+] @comment
 
 ; ==================== Attributes ====================
 
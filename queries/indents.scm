@@ -0,0 +1,69 @@
+; Indentation, with the capture names of nvim-treesitter's indent queries.
+;
+; The scanner already emits the layout as START_BLOCK/END_BLOCK around each
+; block, and the block's contents are a `statements` (or `constructor_list`)
+; node. Patterns are anchored on the nodes that contain one, so the lines after
+; the header are indented one level, and they match direct children only.
+
+; ==================== Blocks ====================
+
+(function_declaration (statements)) @indent.begin
+(trait_function_declaration (statements)) @indent.begin
+(impl_function_declaration (statements)) @indent.begin
+
+(type_declaration (constructor_list)) @indent.begin
+
+; A trait or impl without items has no body. Anchored on the last item, so
+; each declaration matches once.
+(trait_declaration
+  [
+    (trait_function_declaration)
+    (trait_type_declaration)
+  ] .) @indent.begin
+
+(impl_declaration
+  [
+    (impl_function_declaration)
+    (impl_type_declaration)
+  ] .) @indent.begin
+
+(for_statement (statements)) @indent.begin
+(while_statement (statements)) @indent.begin
+(loop_statement (statements)) @indent.begin
+(do_expression (statements)) @indent.begin
+(block_lambda (statements)) @indent.begin
+
+; The `elif` and `else` lines are at the level of the `if`, and their bodies
+; are indented by the `if_expression`.
+(if_expression (statements)) @indent.begin
+
+[
+  (elif_clause)
+  (else_clause)
+] @indent.branch
+
+; Arms one level in, arm bodies two.
+(match_expression) @indent.begin
+(match_arm (statements)) @indent.begin
+
+; ==================== Delimiters ====================
+
+[
+  (param_list)
+  (call_expression)
+  (record_expression)
+  (sequence_expression)
+  (parenthesized_expression)
+  (import_declaration)
+] @indent.begin
+
+[
+  (rparen)
+  (rbracket)
+] @indent.branch
+
+; ==================== Strings and comments ====================
+
+(string_expression) @indent.ignore
+
+(block_comment) @indent.auto
@@ -0,0 +1,44 @@
+; Definitions and references for `tree-sitter tags` and code indexers.
+;
+; Patterns are anchored on declaration node types and match direct children
+; only, so the query engine doesn't have to search subtrees, and they don't use
+; predicates.
+
+; ==================== Functions ====================
+
+(function_declaration
+  (fun_sig . (lower_id) @name)) @definition.function
+
+(trait_function_declaration
+  (fun_sig . (lower_id) @name)) @definition.method
+
+(impl_function_declaration
+  (fun_sig . (lower_id) @name)) @definition.method
+
+; ==================== Types ====================
+
+(type_declaration (upper_id) @name) @definition.type
+
+(constructor_declaration . (upper_id) @name) @definition.constructor
+
+(trait_declaration (upper_id) @name) @definition.interface
+
+(trait_type_declaration (upper_id) @name) @definition.type
+
+(impl_type_declaration (upper_id) @name) @definition.type
+
+(impl_declaration (upper_id) @name) @reference.implementation
+
+; ==================== Imports ====================
+
+(import_item (import_path) @name) @reference.module
+
+; ==================== References ====================
+
+(call_expression
+  . (variable_expression (lower_id) @name)) @reference.call
+
+(call_expression
+  . (field_access_expression (lower_id) @name)) @reference.call
+
+(named_type (upper_id) @name) @reference.type
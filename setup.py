@@ -0,0 +1,78 @@
+from os import path
+from platform import system
+from sysconfig import get_config_var
+
+from setuptools import Extension, find_packages, setup
+from setuptools.command.build import build
+from setuptools.command.egg_info import egg_info
+from wheel.bdist_wheel import bdist_wheel
+
+sources = [
+    "bindings/python/tree_sitter_fir/binding.c",
+    "src/parser.c",
+    "src/scanner.c",
+]
+
+if limited_api := not get_config_var("Py_GIL_DISABLED"):
+    limited_api = "cp310"
+
+
+class Build(build):
+    def run(self):
+        if path.isdir("queries"):
+            dest = path.join(self.build_lib, "tree_sitter_fir", "queries")
+            self.copy_tree("queries", dest)
+        super().run()
+
+
+class BdistWheel(bdist_wheel):
+    def get_tag(self):
+        python, abi, platform = super().get_tag()
+        if python.startswith("cp") and limited_api:
+            python, abi = limited_api, "abi3"
+        return python, abi, platform
+
+
+class EggInfo(egg_info):
+    def find_sources(self):
+        super().find_sources()
+        self.filelist.recursive_include("queries", "*.scm")
+        self.filelist.include("src/tree_sitter/*.h")
+
+
+setup(
+    packages=find_packages("bindings/python", exclude=["tests"]),
+    package_dir={"": "bindings/python"},
+    package_data={
+        "tree_sitter_fir": ["*.pyi", "py.typed"],
+        "tree_sitter_fir.queries": ["*.scm"],
+    },
+    ext_package="tree_sitter_fir",
+    ext_modules=[
+        Extension(
+            name="_binding",
+            sources=sources,
+            extra_compile_args=[
+                "-std=c11",
+                "-fvisibility=hidden",
+                "-O2",
+            ] if system() != "Windows" else [
+                "/std:c11",
+                "/utf-8",
+                "/O2",
+            ],
+            define_macros=[
+                ("PY_SSIZE_T_CLEAN", None),
+                ("TREE_SITTER_HIDE_SYMBOLS", None),
+            ] + ([("Py_LIMITED_API", "0x030A0000")] if limited_api else []),
+            include_dirs=["src"],
+            py_limited_api=bool(limited_api),
+        )
+    ],
+    cmdclass={
+        "build": Build,
+        "bdist_wheel": BdistWheel,
+        "egg_info": EggInfo,
+    },
+    zip_safe=False,
+)
@@ -1,7 +1,7 @@
+#include "tree_sitter/array.h"
 #include "tree_sitter/parser.h"
 
 #include <stdbool.h>
-#include <string.h>
 #include <stdio.h>
 
 // Token types - MUST match the externals array order in grammar.js exactly
@@ -11,28 +11,26 @@ enum TokenType {
     END_BLOCK,    // emitted when an indented block ends (DEDENT)
     NEWLINE,
 
-    // Identifiers (3-6)
-    UPPER_ID,
-    LOWER_ID,
+    // Identifiers (3-4)
     MODULE_PREFIX,  // (UpperId '/')+ — e.g. "Fir/", "M1/M2/"
     LABEL,
 
-    // Literals (10-11)
+    // Literals (5-6)
     INT_LITERAL,
     CHAR_LITERAL,
 
-    // String tokens (12-16)
+    // String tokens (7-11)
     BEGIN_STR,
     END_STR,
     STRING_CONTENT,
     BEGIN_INTERPOLATION,
     END_INTERPOLATION,
 
-    // Comments (17-18)
+    // Comments (12-13)
     BLOCK_COMMENT,
     LINE_COMMENT,
 
-    // Delimiters (19-27)
+    // Delimiters (14-21)
     LPAREN,
     RPAREN,
     LBRACKET,
@@ -42,77 +40,15 @@ enum TokenType {
     BACKSLASH_LPAREN,
     HASH_LBRACKET,  // #[ — start of an attribute
 
-    // Punctuation (26-33)
-    COLON,
-    COMMA,
-    DOT,
-    DOTDOT,
-    EQ,
-    UNDERSCORE,
-    SLASH,
-    SEMICOLON,
-
-    // Operators (36-57)
-    PLUS,
-    MINUS,
-    STAR,
-    EQEQ,
-    NEQ,
-    LT,
-    GT,
-    LTEQ,
-    GTEQ,
-    LSHIFT,
-    RSHIFT,
-    AMP,
-    AMPAMP,
-    PIPE,
-    TILDE,
-    EXCLAMATION,
-    PERCENT,
-    CARET,
-    PLUSEQ,
-    MINUSEQ,
-    STAREQ,
-    CARETEQ,
-
-    // Keywords (58+)
-    KW_AND,
-    KW_AS,
-    KW_BREAK,
-    KW_CONTINUE,
-    KW_DO,
-    KW_ELIF,
-    KW_ELSE,
-    KW_EXTERN,
-    KW_FN,
-    KW_UPPER_FN,
-    KW_FOR,
-    KW_IF,
-    KW_IMPL,
-    KW_IMPORT,
-    KW_IN,
-    KW_IS,
-    KW_LET,
-    KW_LOOP,
-    KW_MATCH,
-    KW_NOT,
-    KW_OR,
-    KW_PRIM,
-    KW_RETURN,
-    KW_TRAIT,
-    KW_TYPE,
-    KW_VALUE,
-    KW_WHILE,
-    // 'row' is not a keyword in the reference implementation, but it is here,
-    // to be able to treat `row[` as two tokens and use the `[` as a delimiter
-    // in queries.
-    KW_ROW,
+    // A whole string without interpolation, see `scan_double_quote`.
+    STRING_LITERAL,
+    // `.` in a constructor path, see `scan_dot`.
+    PATH_DOT,
 
     TOKEN_COUNT,
 };
 
-// Frame types for the delimiter/indentation stack
+// Frame types for the delimiter/indentation stack. Serialized in 2 bits.
 typedef enum {
     FRAME_INDENTED,
     FRAME_PAREN,
@@ -125,16 +61,147 @@ typedef struct {
     uint16_t block_col;  // only meaningful for FRAME_INDENTED
 } Frame;
 
-#define MAX_DEPTH 128
+// Serialized state format
+//
+// The ground state (only the bottom frame, no pending END_BLOCKs, not in a
+// string, no EOF NEWLINE emitted yet) is serialized as zero bytes. Otherwise:
+//
+// - A flags byte (STATE_*).
+// - If STATE_PENDING_END_BLOCKS is set, a byte with `pending_end_blocks`.
+// - One entry per frame above the bottom frame (which is always FRAME_INDENTED
+//   with column 0), until the end of the buffer. An entry is a byte with the
+//   frame kind in the low 2 bits. For FRAME_INDENTED the top 6 bits hold the
+//   zigzag-encoded difference between the frame's `block_col` and the
+//   previous FRAME_INDENTED frame's. If the difference doesn't fit, the top
+//   bits are all ones and the difference follows as a LEB128 varint.
+//
+// With the usual indentation steps every frame takes one byte.
+
+#define STATE_IN_STRING 0x01
+#define STATE_EOF_NEWLINE_EMITTED 0x02
+#define STATE_PENDING_END_BLOCKS 0x04
+
+#define FRAME_KIND_BITS 2
+#define FRAME_KIND_MASK 0x03
+#define FRAME_DELTA_ESCAPE 0x3F
+
+// Max. size of a frame entry: the entry byte and a 3-byte varint (zigzag
+// encoding of a 16-bit difference needs 17 bits).
+#define MAX_FRAME_ENTRY_SIZE 4
+
+#define MAX_STATE_HEADER_SIZE 2
+
+// Max. depth of the frame stack, including the bottom frame. Deeper frames
+// wouldn't fit in the serialization buffer, and `pending_end_blocks` counts
+// frames in a `uint8_t`. Tokens that would push a frame past this depth are
+// not recognized, so deeply nested input fails to parse at the frame that
+// doesn't fit instead of silently losing frames.
+#define MAX_SERIALIZED_FRAMES \
+    (1 + (TREE_SITTER_SERIALIZATION_BUFFER_SIZE - MAX_STATE_HEADER_SIZE) / MAX_FRAME_ENTRY_SIZE)
+#define MAX_DEPTH (MAX_SERIALIZED_FRAMES < UINT8_MAX ? MAX_SERIALIZED_FRAMES : UINT8_MAX)
+
+// Initial capacity of the frame stack. Enough for most code without growing.
+#define INITIAL_STACK_CAPACITY 16
 
 typedef struct {
-    Frame stack[MAX_DEPTH];
-    uint8_t depth;           // always >= 1 (bottom = FRAME_INDENTED col=0)
+    Array(Frame) stack;      // size always >= 1 (bottom = FRAME_INDENTED col=0)
     uint8_t pending_end_blocks;
     bool in_string;          // inside a string literal
     bool eof_newline_emitted;
 } Scanner;
 
+// ==================== Statistics ====================
+
+// With FIR_SCANNER_STATS defined, the scanner counts what it does, to see why
+// a file is slow to scan. The counters are global (shared by all parsers, and
+// not synchronized between threads) and `fir_scanner_stats_print` prints them.
+// Without FIR_SCANNER_STATS the counting macros expand to nothing.
+
+// Token names, for the statistics and for bench/scanner.c, which defines
+// FIR_SCANNER_TOKEN_NAMES.
+#if defined(FIR_SCANNER_STATS) || defined(FIR_SCANNER_TOKEN_NAMES)
+static const char *const token_names[TOKEN_COUNT] = {
+    [START_BLOCK] = "START_BLOCK", [END_BLOCK] = "END_BLOCK", [NEWLINE] = "NEWLINE",
+    [MODULE_PREFIX] = "MODULE_PREFIX", [LABEL] = "LABEL", [INT_LITERAL] = "INT_LITERAL",
+    [CHAR_LITERAL] = "CHAR_LITERAL", [BEGIN_STR] = "BEGIN_STR", [END_STR] = "END_STR",
+    [STRING_CONTENT] = "STRING_CONTENT", [BEGIN_INTERPOLATION] = "BEGIN_INTERPOLATION",
+    [END_INTERPOLATION] = "END_INTERPOLATION", [BLOCK_COMMENT] = "BLOCK_COMMENT",
+    [LINE_COMMENT] = "LINE_COMMENT", [LPAREN] = "LPAREN", [RPAREN] = "RPAREN",
+    [LBRACKET] = "LBRACKET", [RBRACKET] = "RBRACKET", [LBRACE] = "LBRACE", [RBRACE] = "RBRACE",
+    [BACKSLASH_LPAREN] = "BACKSLASH_LPAREN", [HASH_LBRACKET] = "HASH_LBRACKET",
+    [STRING_LITERAL] = "STRING_LITERAL", [PATH_DOT] = "PATH_DOT",
+};
+#endif
+
+#ifdef FIR_SCANNER_STATS
+
+// Sections of `scan`, for attributing consumed characters.
+typedef enum {
+    SECTION_PENDING,  // 1. pending END_BLOCKs
+    SECTION_STRING,   // 2. string mode
+    SECTION_LAYOUT,   // 3. whitespace and layout
+    SECTION_TOKENS,   // 4. tokens
+    SECTION_RECOVERY, // error recovery
+    SECTION_COUNT,
+} StatsSection;
+
+static const char *const stats_section_names[SECTION_COUNT] = {
+    [SECTION_PENDING] = "pending", [SECTION_STRING] = "string",
+    [SECTION_LAYOUT] = "layout", [SECTION_TOKENS] = "tokens",
+    [SECTION_RECOVERY] = "recovery",
+};
+
+typedef struct {
+    uint64_t scans;
+    uint64_t failed_scans;
+    uint64_t tokens[TOKEN_COUNT];
+    uint64_t advanced[SECTION_COUNT];
+    uint64_t skipped[SECTION_COUNT];
+    uint64_t get_column_calls;  // calls to the runtime, when the column isn't known
+    uint64_t depth_histogram[MAX_DEPTH + 1];  // frame stack depth at each scan
+} ScannerStats;
+
+static ScannerStats stats;
+static StatsSection stats_section;
+
+#define STATS_SECTION(section) (stats_section = (section))
+#define STATS_COUNT(counter) (stats.counter++)
+
+void fir_scanner_stats_reset(void) {
+    stats = (ScannerStats){0};
+}
+
+void fir_scanner_stats_print(FILE *out) {
+    fprintf(out, "scanner: %llu scans, %llu failed, %llu get_column calls\n",
+            (unsigned long long)stats.scans, (unsigned long long)stats.failed_scans,
+            (unsigned long long)stats.get_column_calls);
+
+    fprintf(out, "characters (advanced/skipped):\n");
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        fprintf(out, "  %-16s %12llu %12llu\n", stats_section_names[i],
+                (unsigned long long)stats.advanced[i], (unsigned long long)stats.skipped[i]);
+    }
+
+    fprintf(out, "tokens:\n");
+    for (int i = 0; i < TOKEN_COUNT; i++) {
+        if (stats.tokens[i] == 0) continue;
+        fprintf(out, "  %-16s %12llu\n", token_names[i], (unsigned long long)stats.tokens[i]);
+    }
+
+    fprintf(out, "frame stack depth:\n");
+    for (int i = 0; i <= MAX_DEPTH; i++) {
+        if (stats.depth_histogram[i] == 0) continue;
+        fprintf(out, "  %-16d %12llu\n", i, (unsigned long long)stats.depth_histogram[i]);
+    }
+}
+
+#else
+
+#define STATS_SECTION(section) ((void)0)
+#define STATS_COUNT(counter) ((void)0)
+
+#endif
+
 // ==================== Helpers ====================
 
 static inline bool is_upper(int32_t c) { return c >= 'A' && c <= 'Z'; }
@@ -145,24 +212,38 @@ static inline bool is_id_char(int32_t c) { return is_alnum(c) || c == '_'; }
 static inline bool is_hex(int32_t c) { return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
 static inline bool is_bin(int32_t c) { return c == '0' || c == '1'; }
 
+static inline uint32_t depth(Scanner *s) {
+    return s->stack.size;
+}
+
 static Frame top_frame(Scanner *s) {
-    return s->stack[s->depth - 1];
+    return *array_back(&s->stack);
 }
 
-static void push_frame(Scanner *s, FrameKind kind, uint16_t col) {
-    if (s->depth < MAX_DEPTH) {
-        s->stack[s->depth].kind = kind;
-        s->stack[s->depth].block_col = col;
-        s->depth++;
+// Returns false (and doesn't push) if the stack is already at MAX_DEPTH.
+static bool push_frame(Scanner *s, FrameKind kind, uint16_t col) {
+    if (depth(s) >= MAX_DEPTH) {
+        return false;
     }
+    array_push(&s->stack, ((Frame){.kind = kind, .block_col = col}));
+    return true;
 }
 
 static void pop_frame(Scanner *s) {
-    if (s->depth > 1) {
-        s->depth--;
+    if (depth(s) > 1) {
+        (void)array_pop(&s->stack);
     }
 }
 
+// Reset to the ground state: only the bottom frame, no pending END_BLOCKs.
+static void reset(Scanner *s) {
+    array_clear(&s->stack);
+    array_push(&s->stack, ((Frame){.kind = FRAME_INDENTED, .block_col = 0}));
+    s->pending_end_blocks = 0;
+    s->in_string = false;
+    s->eof_newline_emitted = false;
+}
+
 // Check if we're inside a non-indented frame (paren/bracket/interpolation)
 static bool in_non_indented(Scanner *s) {
     Frame f = top_frame(s);
@@ -172,8 +253,8 @@ static bool in_non_indented(Scanner *s) {
 // Count INDENTED frames above the nearest non-INDENTED frame
 static uint8_t indented_frames_above_delimiter(Scanner *s) {
     uint8_t count = 0;
-    for (int i = s->depth - 1; i >= 0; i--) {
-        if (s->stack[i].kind == FRAME_INDENTED) {
+    for (int i = (int)depth(s) - 1; i >= 0; i--) {
+        if (s->stack.contents[i].kind == FRAME_INDENTED) {
             count++;
         } else {
             break;
@@ -185,40 +266,71 @@ static uint8_t indented_frames_above_delimiter(Scanner *s) {
 // Advance the lexer and return the character consumed
 static int32_t advance(TSLexer *lexer) {
     int32_t c = lexer->lookahead;
+    STATS_COUNT(advanced[stats_section]);
     lexer->advance(lexer, false);
     return c;
 }
 
 static void skip(TSLexer *lexer) {
+    STATS_COUNT(skipped[stats_section]);
     lexer->advance(lexer, true);
 }
 
-// Skip horizontal whitespace (spaces and tabs), return the column after skipping
-static void skip_horizontal_ws(TSLexer *lexer) {
+// Column of the lookahead, counted while skipping whitespace. The runtime's
+// `get_column` re-reads the line from its start, so the layout code uses this
+// instead when it can. Only known once a newline was skipped in the current
+// scan: before that, the scan started somewhere in the line.
+typedef struct {
+    uint32_t value;
+    bool known;
+} Column;
+
+// Skip the lookahead and update `column` (can be NULL). Counts characters like
+// `get_column`: a tab is one column.
+static void skip_counting(TSLexer *lexer, Column *column) {
+    if (column) {
+        if (lexer->lookahead == '\n') {
+            column->value = 0;
+            column->known = true;
+        } else {
+            column->value++;
+        }
+    }
+    skip(lexer);
+}
+
+static uint32_t get_column(TSLexer *lexer, const Column *column) {
+    if (column && column->known) return column->value;
+    STATS_COUNT(get_column_calls);
+    return lexer->get_column(lexer);
+}
+
+// Skip horizontal whitespace (spaces and tabs)
+static void skip_horizontal_ws(TSLexer *lexer, Column *column) {
     while (lexer->lookahead == ' ' || lexer->lookahead == '\t') {
-        skip(lexer);
+        skip_counting(lexer, column);
     }
 }
 
 // Skip all whitespace including newlines
-static void skip_all_ws(TSLexer *lexer) {
+static void skip_all_ws(TSLexer *lexer, Column *column) {
     while (lexer->lookahead == ' ' || lexer->lookahead == '\t' ||
            lexer->lookahead == '\n' || lexer->lookahead == '\r') {
-        skip(lexer);
+        skip_counting(lexer, column);
     }
 }
 
 // Skip newlines and blank lines (lines with only whitespace).
 // Stops at any non-whitespace character, including comments.
-static void skip_blank_lines(TSLexer *lexer) {
+static void skip_blank_lines(TSLexer *lexer, Column *column) {
     while (true) {
         if (lexer->lookahead == '\n' || lexer->lookahead == '\r') {
-            skip(lexer);
+            skip_counting(lexer, column);
             continue;
         }
         if (lexer->lookahead == ' ' || lexer->lookahead == '\t') {
             while (lexer->lookahead == ' ' || lexer->lookahead == '\t') {
-                skip(lexer);
+                skip_counting(lexer, column);
             }
             // If we hit a newline, it was a blank line — continue skipping
             if (lexer->lookahead == '\n' || lexer->lookahead == '\r') {
@@ -231,68 +343,14 @@ static void skip_blank_lines(TSLexer *lexer) {
     }
 }
 
-// ==================== Keyword matching ====================
-
-typedef struct {
-    const char *text;
-    enum TokenType token;
-} Keyword;
-
-static const Keyword keywords[] = {
-    {"and", KW_AND},
-    {"as", KW_AS},
-    {"break", KW_BREAK},
-    {"continue", KW_CONTINUE},
-    {"do", KW_DO},
-    {"elif", KW_ELIF},
-    {"else", KW_ELSE},
-    {"extern", KW_EXTERN},
-    {"fn", KW_FN},
-    {"for", KW_FOR},
-    {"if", KW_IF},
-    {"impl", KW_IMPL},
-    {"import", KW_IMPORT},
-    {"in", KW_IN},
-    {"is", KW_IS},
-    {"let", KW_LET},
-    {"loop", KW_LOOP},
-    {"match", KW_MATCH},
-    {"not", KW_NOT},
-    {"or", KW_OR},
-    {"prim", KW_PRIM},
-    {"return", KW_RETURN},
-    {"row", KW_ROW},
-    {"trait", KW_TRAIT},
-    {"type", KW_TYPE},
-    {"value", KW_VALUE},
-    {"while", KW_WHILE},
-    {NULL, 0},
-};
-
-static enum TokenType lookup_keyword(const char *word, int len) {
-    for (const Keyword *kw = keywords; kw->text; kw++) {
-        if ((int)strlen(kw->text) == len && strncmp(kw->text, word, len) == 0) {
-            return kw->token;
-        }
-    }
-    return LOWER_ID;
-}
-
 // ==================== Token scanning functions ====================
 
-// After consuming an UpperId (mark_end already at end of that id), try to
-// extend into a ModulePrefix by consuming `/ UpperId /` segments. Returns
-// true and updates mark_end to the final `/` if at least one `/` was
-// consumed. The UpperId (or later segments) we peeked past without a
-// trailing `/` is left as lookahead — tree-sitter re-reads from mark_end.
-static bool try_module_prefix_tail(TSLexer *lexer, const bool *valid) {
-    if (!valid[MODULE_PREFIX]) return false;
-    if (lexer->lookahead != '/') return false;
-    advance(lexer); // consume '/'
-    lexer->mark_end(lexer);
-
-    // Greedily consume additional `UpperId /` segments.
-    while (lexer->lookahead == '_' || is_upper(lexer->lookahead)) {
+// Scan a module prefix, `(_*[A-Z][A-Za-z0-9_]* '/')+`, with mark_end after
+// the last `/`. Returns false if the first upper-case identifier isn't
+// followed by `/`: identifiers are lexed by the generated lexer.
+static bool scan_module_prefix(TSLexer *lexer) {
+    bool found = false;
+    for (;;) {
         while (lexer->lookahead == '_') advance(lexer);
         if (!is_upper(lexer->lookahead)) break;
         advance(lexer);
@@ -301,67 +359,9 @@ static bool try_module_prefix_tail(TSLexer *lexer, const bool *valid) {
         if (lexer->lookahead != '/') break;
         advance(lexer);
         lexer->mark_end(lexer);
+        found = true;
     }
-
-    return true;
-}
-
-// Scan an upper-case identifier.
-// Assumes lookahead is '_' or uppercase letter.
-// Returns the token type (UPPER_ID, KW_UPPER_FN, or MODULE_PREFIX).
-static enum TokenType scan_upper_id(TSLexer *lexer, const bool *valid) {
-    // Consume _*[A-Z][A-Za-z0-9_]*
-    char word[64];
-    int len = 0;
-    while (lexer->lookahead == '_' && len < 63) { word[len++] = (char)advance(lexer); }
-    if (!is_upper(lexer->lookahead)) return TOKEN_COUNT; // not actually upper id
-    word[len++] = (char)advance(lexer); // consume first upper char
-    while (is_id_char(lexer->lookahead) && len < 63) { word[len++] = (char)advance(lexer); }
-    word[len] = '\0';
-
-    lexer->mark_end(lexer);
-
-    // If followed immediately by '/', try to scan a module prefix instead.
-    if (try_module_prefix_tail(lexer, valid)) {
-        return MODULE_PREFIX;
-    }
-
-    // Check for "Fn" keyword
-    if (len == 2 && word[0] == 'F' && word[1] == 'n') {
-        if (valid[KW_UPPER_FN]) return KW_UPPER_FN;
-    }
-
-    return UPPER_ID;
-}
-
-// Scan a lower-case identifier or keyword.
-static enum TokenType scan_lower_id_or_keyword(TSLexer *lexer, Scanner *scanner, const bool *valid) {
-    char word[64];
-    int len = 0;
-
-    // Consume _*[a-z][A-Za-z0-9_]*
-    while (lexer->lookahead == '_' && len < 63) {
-        word[len++] = (char)advance(lexer);
-    }
-    if (!is_lower(lexer->lookahead)) {
-        // Just underscores - this shouldn't happen (underscore is separate)
-        return TOKEN_COUNT;
-    }
-    word[len++] = (char)advance(lexer);
-    while (is_id_char(lexer->lookahead) && len < 63) {
-        word[len++] = (char)advance(lexer);
-    }
-    word[len] = '\0';
-
-    lexer->mark_end(lexer);
-
-    // Check for keyword
-    enum TokenType kw = lookup_keyword(word, len);
-    if (kw != LOWER_ID && valid[kw]) {
-        return kw;
-    }
-
-    return LOWER_ID;
+    return found;
 }
 
 // Scan an integer literal.
@@ -444,9 +444,399 @@ static bool scan_string_content(TSLexer *lexer) {
     }
 }
 
+// ==================== Token handlers ====================
+//
+// `scan` dispatches on the first character of a token through `token_handlers`
+// below. Each handler is called with that character as lookahead, and either
+// scans a token starting with it or returns false.
+
+typedef bool (*TokenHandler)(Scanner *scanner, TSLexer *lexer, const bool *valid);
+
+// Comments and attribute start
+static bool scan_hash(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    (void)scanner;
+    lexer->mark_end(lexer);
+    advance(lexer);
+    if (lexer->lookahead == '[' && valid[HASH_LBRACKET]) {
+        advance(lexer);
+        lexer->mark_end(lexer);
+        lexer->result_symbol = HASH_LBRACKET;
+        return true;
+    }
+    if (lexer->lookahead == '|') {
+        // Block comment
+        if (valid[BLOCK_COMMENT]) {
+            advance(lexer); // consume '|'
+            int depth = 1;
+            while (depth > 0 && lexer->lookahead != 0) {
+                if (lexer->lookahead == '#') {
+                    advance(lexer);
+                    if (lexer->lookahead == '|') { advance(lexer); depth++; }
+                } else if (lexer->lookahead == '|') {
+                    advance(lexer);
+                    if (lexer->lookahead == '#') { advance(lexer); depth--; }
+                } else {
+                    advance(lexer);
+                }
+            }
+            lexer->mark_end(lexer);
+            lexer->result_symbol = BLOCK_COMMENT;
+            return true;
+        }
+        return false;
+    } else {
+        // Line comment
+        if (valid[LINE_COMMENT]) {
+            while (lexer->lookahead != '\n' && lexer->lookahead != 0) {
+                advance(lexer);
+            }
+            lexer->mark_end(lexer);
+            lexer->result_symbol = LINE_COMMENT;
+            return true;
+        }
+        return false;
+    }
+}
+
+// Scan to the closing " of a string, skipping escapes. Returns false if the
+// string has an interpolation or isn't closed.
+static bool scan_to_string_end(TSLexer *lexer) {
+    while (true) {
+        switch (lexer->lookahead) {
+            case '"': return true;
+            case '`':
+            case 0: return false;
+            case '\\':
+                advance(lexer);
+                if (lexer->lookahead != 0) advance(lexer);
+                break;
+            default: advance(lexer);
+        }
+    }
+}
+
+// String start. A string without interpolation is scanned to its end and
+// returned as one STRING_LITERAL, instead of BEGIN_STR, STRING_CONTENT and
+// END_STR from three scans. Otherwise the token ends after the quote.
+static bool scan_double_quote(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[BEGIN_STR]) return false;
+    advance(lexer);
+    // STRING_CONTENT is valid here only in error recovery, which keeps the
+    // three tokens.
+    if (valid[STRING_LITERAL] && !valid[STRING_CONTENT]) {
+        lexer->mark_end(lexer);
+        if (scan_to_string_end(lexer)) {
+            advance(lexer);
+            lexer->mark_end(lexer);
+            lexer->result_symbol = STRING_LITERAL;
+            return true;
+        }
+    }
+    scanner->in_string = true;
+    lexer->result_symbol = BEGIN_STR;
+    return true;
+}
+
+// End interpolation (backtick outside string)
+static bool scan_backtick(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[END_INTERPOLATION]) return false;
+    advance(lexer);
+    // Pop FRAME_INTERPOLATION
+    if (top_frame(scanner).kind == FRAME_INTERPOLATION) {
+        pop_frame(scanner);
+    }
+    scanner->in_string = true;
+    lexer->result_symbol = END_INTERPOLATION;
+    return true;
+}
+
+// Backslash-lparen
+static bool scan_backslash(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    advance(lexer);
+    if (lexer->lookahead == '(' && valid[BACKSLASH_LPAREN]) {
+        advance(lexer);
+        if (!push_frame(scanner, FRAME_PAREN, 0)) return false;
+        lexer->result_symbol = BACKSLASH_LPAREN;
+        return true;
+    }
+    // Just a backslash - currently not used in grammar
+    return false;
+}
+
+// Parentheses
+static bool scan_lparen(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[LPAREN]) return false;
+    advance(lexer);
+    if (!push_frame(scanner, FRAME_PAREN, 0)) return false;
+    lexer->result_symbol = LPAREN;
+    return true;
+}
+
+static bool scan_rparen(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[RPAREN]) return false;
+    advance(lexer);
+    // Pop frame(s)
+    if (top_frame(scanner).kind == FRAME_PAREN) {
+        pop_frame(scanner);
+    }
+    lexer->result_symbol = RPAREN;
+    return true;
+}
+
+// Brackets
+static bool scan_lbracket(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[LBRACKET]) return false;
+    advance(lexer);
+    if (!push_frame(scanner, FRAME_BRACKET, 0)) return false;
+    lexer->result_symbol = LBRACKET;
+    return true;
+}
+
+static bool scan_rbracket(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[RBRACKET]) return false;
+    advance(lexer);
+    if (top_frame(scanner).kind == FRAME_BRACKET) {
+        pop_frame(scanner);
+    }
+    lexer->result_symbol = RBRACKET;
+    return true;
+}
+
+// Braces
+static bool scan_lbrace(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[LBRACE]) return false;
+    advance(lexer);
+    if (!push_frame(scanner, FRAME_INDENTED, 0)) return false;
+    lexer->result_symbol = LBRACE;
+    return true;
+}
+
+static bool scan_rbrace(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (!valid[RBRACE]) return false;
+    advance(lexer);
+    if (top_frame(scanner).kind == FRAME_INDENTED && depth(scanner) > 1) {
+        pop_frame(scanner);
+    }
+    lexer->result_symbol = RBRACE;
+    return true;
+}
+
+// Single quote: could be label or char literal
+static bool scan_single_quote(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    (void)scanner;
+    // Peek: if followed by lowercase letter, could be label
+    advance(lexer); // consume '
+
+    if (is_lower(lexer->lookahead) && valid[LABEL]) {
+        // Could be label: 'identifier
+        // But also could be char literal: 'a'
+        // Labels don't have a closing quote, chars do.
+        // Scan the identifier part, then check for closing quote.
+        int len = 1;
+        advance(lexer);
+        while (is_id_char(lexer->lookahead)) {
+            len++;
+            advance(lexer);
+        }
+
+        if (lexer->lookahead == '\'') {
+            // Char literal with a lowercase char: 'a'
+            // But only if len == 1 (single char)
+            if (len == 1 && valid[CHAR_LITERAL]) {
+                advance(lexer); // consume closing '
+                lexer->result_symbol = CHAR_LITERAL;
+                return true;
+            }
+            // Multi-char like 'ab' - not valid, treat as label
+        }
+
+        // It's a label
+        lexer->mark_end(lexer);
+        lexer->result_symbol = LABEL;
+        return true;
+    }
+
+    if (valid[CHAR_LITERAL]) {
+        // Char literal: 'c' or '\n' etc.
+        if (lexer->lookahead == '\\') {
+            advance(lexer); // consume backslash
+            advance(lexer); // consume escape char
+        } else if (lexer->lookahead != '\'' && lexer->lookahead != 0) {
+            advance(lexer); // consume the character
+        }
+        if (lexer->lookahead == '\'') {
+            advance(lexer); // consume closing '
+            lexer->result_symbol = CHAR_LITERAL;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// `_` or an upper-case letter: a module prefix, or a token for the generated
+// lexer (upper_id, lower_id, `_` or `Fn`).
+static bool scan_upper(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    (void)scanner;
+    if (!valid[MODULE_PREFIX] || !scan_module_prefix(lexer)) return false;
+    lexer->result_symbol = MODULE_PREFIX;
+    return true;
+}
+
+// Digits
+static bool scan_digit(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    (void)scanner;
+    if (!valid[INT_LITERAL]) return false;
+    if (scan_int_literal(lexer)) {
+        lexer->mark_end(lexer);
+        lexer->result_symbol = INT_LITERAL;
+        return true;
+    }
+    return false;
+}
+
+// `.` before an upper-case letter or `[` continues a constructor path
+// (`Type.Con`) or starts a sequence (`Vec.[...]`). Without a token of its
+// own, the parser can't tell after `Type` whether to shift the `.` or reduce
+// `Type` as the object of a field access (`Vec.withCapacity`), so it forks.
+// Any other `.` or `..` is left to the generated lexer.
+static bool scan_dot(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    (void)scanner;
+    if (!valid[PATH_DOT]) return false;
+    advance(lexer);
+    if (is_upper(lexer->lookahead) || lexer->lookahead == '[') {
+        lexer->result_symbol = PATH_DOT;
+        return true;
+    }
+    return false;
+}
+
+// Handler for each ASCII character that can start an external token. NULL for
+// characters that can't; the generated lexer handles those.
+static const TokenHandler token_handlers[128] = {
+    ['#'] = scan_hash,
+    ['"'] = scan_double_quote,
+    ['`'] = scan_backtick,
+    ['\\'] = scan_backslash,
+    ['('] = scan_lparen,
+    [')'] = scan_rparen,
+    ['['] = scan_lbracket,
+    [']'] = scan_rbracket,
+    ['{'] = scan_lbrace,
+    ['}'] = scan_rbrace,
+    ['\''] = scan_single_quote,
+    ['_'] = scan_upper,
+
+    ['A'] = scan_upper, ['B'] = scan_upper, ['C'] = scan_upper, ['D'] = scan_upper,
+    ['E'] = scan_upper, ['F'] = scan_upper, ['G'] = scan_upper, ['H'] = scan_upper,
+    ['I'] = scan_upper, ['J'] = scan_upper, ['K'] = scan_upper, ['L'] = scan_upper,
+    ['M'] = scan_upper, ['N'] = scan_upper, ['O'] = scan_upper, ['P'] = scan_upper,
+    ['Q'] = scan_upper, ['R'] = scan_upper, ['S'] = scan_upper, ['T'] = scan_upper,
+    ['U'] = scan_upper, ['V'] = scan_upper, ['W'] = scan_upper, ['X'] = scan_upper,
+    ['Y'] = scan_upper, ['Z'] = scan_upper,
+
+    ['0'] = scan_digit, ['1'] = scan_digit, ['2'] = scan_digit, ['3'] = scan_digit,
+    ['4'] = scan_digit, ['5'] = scan_digit, ['6'] = scan_digit, ['7'] = scan_digit,
+    ['8'] = scan_digit, ['9'] = scan_digit,
+
+    ['.'] = scan_dot,
+};
+
+// ==================== Error recovery ====================
+//
+// During error recovery tree-sitter calls the scanner with every symbol valid.
+// The layout rules can't work with that: START_BLOCK is zero-width, so it
+// would be emitted, pushing a frame, on every call until the stack is full,
+// and NEWLINE and END_BLOCK would be emitted wherever they fit. So in recovery
+// the scanner only emits plain tokens. It skips whitespace, emits one NEWLINE
+// after each run of line breaks, and emits delimiters without pushing or
+// popping frames. The layout stack stays as it was where the error was found,
+// and every token but NEWLINE consumes input, so recovery takes time linear in
+// the input.
+
+// STRING_CONTENT is only valid inside strings, where blocks can't start, so
+// both being valid means error recovery.
+static inline bool in_error_recovery(const bool *valid) {
+    return valid[STRING_CONTENT] && valid[START_BLOCK];
+}
+
+static bool scan_error_recovery(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    STATS_SECTION(SECTION_RECOVERY);
+
+    if (scanner->in_string) {
+        switch (lexer->lookahead) {
+            case '"':
+                advance(lexer);
+                scanner->in_string = false;
+                lexer->result_symbol = END_STR;
+                return true;
+            case '`':
+                advance(lexer);
+                scanner->in_string = false;
+                lexer->result_symbol = BEGIN_INTERPOLATION;
+                return true;
+            case 0:
+                return false;
+            default:
+                lexer->result_symbol = STRING_CONTENT;
+                return scan_string_content(lexer);
+        }
+    }
+
+    bool at_newline = false;
+    skip_horizontal_ws(lexer, NULL);
+    while (lexer->lookahead == '\n' || lexer->lookahead == '\r') {
+        at_newline = true;
+        skip(lexer);
+        skip_horizontal_ws(lexer, NULL);
+    }
+
+    if (lexer->eof(lexer)) return false;
+
+    if (at_newline) {
+        lexer->result_symbol = NEWLINE;
+        return true;
+    }
+
+    enum TokenType symbol;
+    switch (lexer->lookahead) {
+        case '(': symbol = LPAREN; break;
+        case ')': symbol = RPAREN; break;
+        case '[': symbol = LBRACKET; break;
+        case ']': symbol = RBRACKET; break;
+        case '{': symbol = LBRACE; break;
+        case '}': symbol = RBRACE; break;
+        case '`':
+            advance(lexer);
+            scanner->in_string = true;
+            lexer->result_symbol = END_INTERPOLATION;
+            return true;
+        case '\\':
+            advance(lexer);
+            if (lexer->lookahead != '(') return false;
+            symbol = BACKSLASH_LPAREN;
+            break;
+        default: {
+            // The other handlers don't touch the frame stack.
+            int32_t c = lexer->lookahead;
+            if (c >= 0 && c < 128 && token_handlers[c] != NULL) {
+                return token_handlers[c](scanner, lexer, valid);
+            }
+            return false;
+        }
+    }
+    advance(lexer);
+    lexer->result_symbol = symbol;
+    return true;
+}
+
 // ==================== Main scan function ====================
 
 static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
+    if (in_error_recovery(valid)) {
+        return scan_error_recovery(scanner, lexer, valid);
+    }
+
     // 1. Pending end_blocks (dedents)
     if (scanner->pending_end_blocks > 0 && valid[END_BLOCK]) {
         scanner->pending_end_blocks--;
@@ -457,6 +847,7 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
 
     // 2. String mode
     if (scanner->in_string) {
+        STATS_SECTION(SECTION_STRING);
         if (valid[STRING_CONTENT] && lexer->lookahead != '"' && lexer->lookahead != '`' && lexer->lookahead != 0) {
             lexer->result_symbol = STRING_CONTENT;
             return scan_string_content(lexer);
@@ -468,9 +859,9 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
             return true;
         }
         if (valid[BEGIN_INTERPOLATION] && lexer->lookahead == '`') {
+            if (!push_frame(scanner, FRAME_INTERPOLATION, 0)) return false;
             advance(lexer);
             scanner->in_string = false;
-            push_frame(scanner, FRAME_INTERPOLATION, 0);
             lexer->result_symbol = BEGIN_INTERPOLATION;
             return true;
         }
@@ -478,18 +869,21 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
     }
 
     // 3. Handle whitespace and layout
+    STATS_SECTION(SECTION_LAYOUT);
+
+    Column column = {0, false};
 
     // In non-indented mode: skip whitespace
     if (in_non_indented(scanner)) {
         // Skip horizontal whitespace first
-        skip_horizontal_ws(lexer);
+        skip_horizontal_ws(lexer, &column);
 
         // If grammar wants NEWLINE and we're at a newline, emit it
         if (valid[NEWLINE] && (lexer->lookahead == '\n' || lexer->lookahead == '\r')) {
             // Skip the newline(s) and any following blank lines
             while (lexer->lookahead == '\n' || lexer->lookahead == '\r') {
                 skip(lexer);
-                skip_horizontal_ws(lexer);
+                skip_horizontal_ws(lexer, NULL);
             }
             lexer->result_symbol = NEWLINE;
             return true;
@@ -497,14 +891,14 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
 
         // Skip remaining whitespace (newlines are not significant in non-indented mode).
         // Don't skip comments — let section 4 emit them as proper tokens.
-        skip_all_ws(lexer);
+        skip_all_ws(lexer, &column);
 
         // Check for START_BLOCK request inside non-indented context.
         // If we're at a comment, fall through to section 4 to emit it first.
         // Tree-sitter will call us again with valid[START_BLOCK] still true.
         if (valid[START_BLOCK] && lexer->lookahead != '#') {
-            uint32_t col = lexer->get_column(lexer);
-            push_frame(scanner, FRAME_INDENTED, (uint16_t)col);
+            uint32_t col = get_column(lexer, &column);
+            if (!push_frame(scanner, FRAME_INDENTED, (uint16_t)col)) return false;
             lexer->result_symbol = START_BLOCK;
             return true;
         }
@@ -515,14 +909,14 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
         bool at_newline = false;
 
         // Skip horizontal whitespace on current line
-        skip_horizontal_ws(lexer);
+        skip_horizontal_ws(lexer, &column);
 
         // Check for newline(s)
         while (lexer->lookahead == '\n' || lexer->lookahead == '\r') {
             at_newline = true;
-            skip(lexer);
+            skip_counting(lexer, &column);
             // Skip horizontal whitespace on next line
-            skip_horizontal_ws(lexer);
+            skip_horizontal_ws(lexer, &column);
             // Skip blank lines
             if (lexer->lookahead == '\n' || lexer->lookahead == '\r') {
                 continue;
@@ -537,7 +931,7 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
                 lexer->result_symbol = NEWLINE;
                 return true;
             }
-            if (valid[END_BLOCK] && top_frame(scanner).kind == FRAME_INDENTED && scanner->depth > 1) {
+            if (valid[END_BLOCK] && top_frame(scanner).kind == FRAME_INDENTED && depth(scanner) > 1) {
                 pop_frame(scanner);
                 lexer->result_symbol = END_BLOCK;
                 return true;
@@ -556,13 +950,13 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
                 // Still on the ':' line after horizontal whitespace was skipped.
                 if (lexer->lookahead == '\n' || lexer->lookahead == '\r') {
                     // Just whitespace after ':', skip to next non-blank line.
-                    skip_blank_lines(lexer);
+                    skip_blank_lines(lexer, &column);
                     // Now at first non-blank-line token, fall through below.
                 } else if (lexer->lookahead != '#') {
                     // Code on the same line as ':' (e.g. `A: expr`).
                     // Use current column as block indent.
-                    uint32_t col = lexer->get_column(lexer);
-                    push_frame(scanner, FRAME_INDENTED, (uint16_t)col);
+                    uint32_t col = get_column(lexer, &column);
+                    if (!push_frame(scanner, FRAME_INDENTED, (uint16_t)col)) return false;
                     lexer->result_symbol = START_BLOCK;
                     return true;
                 }
@@ -575,8 +969,8 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
             // If it's a comment, fall through to section 4 to emit it.
             // Otherwise emit START_BLOCK.
             if (lexer->lookahead != '#') {
-                uint32_t col = lexer->get_column(lexer);
-                push_frame(scanner, FRAME_INDENTED, (uint16_t)col);
+                uint32_t col = get_column(lexer, &column);
+                if (!push_frame(scanner, FRAME_INDENTED, (uint16_t)col)) return false;
                 lexer->result_symbol = START_BLOCK;
                 return true;
             }
@@ -594,7 +988,7 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
                 }
                 return true;
             }
-            if (valid[END_BLOCK] && top_frame(scanner).kind == FRAME_INDENTED && scanner->depth > 1) {
+            if (valid[END_BLOCK] && top_frame(scanner).kind == FRAME_INDENTED && depth(scanner) > 1) {
                 pop_frame(scanner);
                 lexer->result_symbol = END_BLOCK;
                 return true;
@@ -603,14 +997,15 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
 
         // Indentation check after newline
         if (at_newline) {
-            uint32_t col = lexer->get_column(lexer);
+            uint32_t col = get_column(lexer, &column);
             Frame frame = top_frame(scanner);
 
             if (col < frame.block_col) {
                 // Dedented - count how many frames need to be popped
                 uint8_t dedent_count = 0;
-                for (int i = scanner->depth - 1; i >= 1; i--) {
-                    if (scanner->stack[i].kind == FRAME_INDENTED && scanner->stack[i].block_col > col) {
+                for (int i = (int)depth(scanner) - 1; i >= 1; i--) {
+                    Frame frame = scanner->stack.contents[i];
+                    if (frame.kind == FRAME_INDENTED && frame.block_col > col) {
                         dedent_count++;
                     } else {
                         break;
@@ -642,6 +1037,7 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
     }
 
     // 4. Scan actual tokens
+    STATS_SECTION(SECTION_TOKENS);
 
     int32_t c = lexer->lookahead;
 
@@ -652,7 +1048,7 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
             lexer->result_symbol = NEWLINE;
             return true;
         }
-        if (valid[END_BLOCK] && top_frame(scanner).kind == FRAME_INDENTED && scanner->depth > 1) {
+        if (valid[END_BLOCK] && top_frame(scanner).kind == FRAME_INDENTED && depth(scanner) > 1) {
             pop_frame(scanner);
             lexer->result_symbol = END_BLOCK;
             return true;
@@ -660,458 +1056,77 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid) {
         return false;
     }
 
-    // Comments and attribute start
-    if (c == '#') {
-        lexer->mark_end(lexer);
-        advance(lexer);
-        if (lexer->lookahead == '[' && valid[HASH_LBRACKET]) {
-            advance(lexer);
-            lexer->mark_end(lexer);
-            lexer->result_symbol = HASH_LBRACKET;
-            return true;
-        }
-        if (lexer->lookahead == '|') {
-            // Block comment
-            if (valid[BLOCK_COMMENT]) {
-                advance(lexer); // consume '|'
-                int depth = 1;
-                while (depth > 0 && lexer->lookahead != 0) {
-                    if (lexer->lookahead == '#') {
-                        advance(lexer);
-                        if (lexer->lookahead == '|') { advance(lexer); depth++; }
-                    } else if (lexer->lookahead == '|') {
-                        advance(lexer);
-                        if (lexer->lookahead == '#') { advance(lexer); depth--; }
-                    } else {
-                        advance(lexer);
-                    }
-                }
-                lexer->mark_end(lexer);
-                lexer->result_symbol = BLOCK_COMMENT;
-                return true;
-            }
-            return false;
-        } else {
-            // Line comment
-            if (valid[LINE_COMMENT]) {
-                while (lexer->lookahead != '\n' && lexer->lookahead != 0) {
-                    advance(lexer);
-                }
-                lexer->mark_end(lexer);
-                lexer->result_symbol = LINE_COMMENT;
-                return true;
-            }
-            return false;
-        }
-    }
-
-    // String start
-    if (c == '"' && valid[BEGIN_STR]) {
-        advance(lexer);
-        scanner->in_string = true;
-        lexer->result_symbol = BEGIN_STR;
-        return true;
-    }
-
-    // End interpolation (backtick outside string)
-    if (c == '`' && valid[END_INTERPOLATION]) {
-        advance(lexer);
-        // Pop FRAME_INTERPOLATION
-        if (top_frame(scanner).kind == FRAME_INTERPOLATION) {
-            pop_frame(scanner);
-        }
-        scanner->in_string = true;
-        lexer->result_symbol = END_INTERPOLATION;
-        return true;
-    }
-
-    // Backslash-lparen
-    if (c == '\\') {
-        advance(lexer);
-        if (lexer->lookahead == '(' && valid[BACKSLASH_LPAREN]) {
-            advance(lexer);
-            push_frame(scanner, FRAME_PAREN, 0);
-            lexer->result_symbol = BACKSLASH_LPAREN;
-            return true;
-        }
-        // Just a backslash - currently not used in grammar
-        return false;
-    }
-
-    // Parentheses
-    if (c == '(' && valid[LPAREN]) {
-        advance(lexer);
-        push_frame(scanner, FRAME_PAREN, 0);
-        lexer->result_symbol = LPAREN;
-        return true;
-    }
-
-    if (c == ')' && valid[RPAREN]) {
-        advance(lexer);
-        // Pop frame(s)
-        if (top_frame(scanner).kind == FRAME_PAREN) {
-            pop_frame(scanner);
-        }
-        lexer->result_symbol = RPAREN;
-        return true;
-    }
-
-    // Brackets
-    if (c == '[' && valid[LBRACKET]) {
-        advance(lexer);
-        push_frame(scanner, FRAME_BRACKET, 0);
-        lexer->result_symbol = LBRACKET;
-        return true;
-    }
-
-    if (c == ']' && valid[RBRACKET]) {
-        advance(lexer);
-        if (top_frame(scanner).kind == FRAME_BRACKET) {
-            pop_frame(scanner);
-        }
-        lexer->result_symbol = RBRACKET;
-        return true;
-    }
-
-    // Braces
-    if (c == '{' && valid[LBRACE]) {
-        advance(lexer);
-        push_frame(scanner, FRAME_INDENTED, 0);
-        lexer->result_symbol = LBRACE;
-        return true;
-    }
-
-    if (c == '}' && valid[RBRACE]) {
-        advance(lexer);
-        if (top_frame(scanner).kind == FRAME_INDENTED && scanner->depth > 1) {
-            pop_frame(scanner);
-        }
-        lexer->result_symbol = RBRACE;
-        return true;
-    }
-
-    // Single quote: could be label or char literal
-    if (c == '\'') {
-        // Peek: if followed by lowercase letter, could be label
-        advance(lexer); // consume '
-
-        if (is_lower(lexer->lookahead) && valid[LABEL]) {
-            // Could be label: 'identifier
-            // But also could be char literal: 'a'
-            // Labels don't have a closing quote, chars do.
-            // Scan the identifier part, then check for closing quote.
-            char buf[64];
-            int len = 0;
-            buf[len++] = (char)lexer->lookahead;
-            advance(lexer);
-            while (is_id_char(lexer->lookahead) && len < 63) {
-                buf[len++] = (char)lexer->lookahead;
-                advance(lexer);
-            }
-
-            if (lexer->lookahead == '\'') {
-                // Char literal with a lowercase char: 'a'
-                // But only if len == 1 (single char)
-                if (len == 1 && valid[CHAR_LITERAL]) {
-                    advance(lexer); // consume closing '
-                    lexer->result_symbol = CHAR_LITERAL;
-                    return true;
-                }
-                // Multi-char like 'ab' - not valid, treat as label
-            }
-
-            // It's a label
-            lexer->mark_end(lexer);
-            lexer->result_symbol = LABEL;
-            return true;
-        }
-
-        if (valid[CHAR_LITERAL]) {
-            // Char literal: 'c' or '\n' etc.
-            if (lexer->lookahead == '\\') {
-                advance(lexer); // consume backslash
-                advance(lexer); // consume escape char
-            } else if (lexer->lookahead != '\'' && lexer->lookahead != 0) {
-                advance(lexer); // consume the character
-            }
-            if (lexer->lookahead == '\'') {
-                advance(lexer); // consume closing '
-                lexer->result_symbol = CHAR_LITERAL;
-                return true;
-            }
-        }
-
-        return false;
-    }
-
-    // Identifiers
-    if (c == '_' || is_upper(c)) {
-        // Could be upper_id, underscore, or lower_id starting with _
-        if (c == '_') {
-            // Check what follows: if just underscores or nothing after, it's UNDERSCORE
-            // If followed by uppercase, it's upper_id
-            // If followed by lowercase, it's lower_id
-            // Peek ahead
-            advance(lexer); // consume first _
-            lexer->mark_end(lexer); // mark after first _ for UNDERSCORE case
-
-            // Count underscores
-            while (lexer->lookahead == '_') advance(lexer);
-
-            if (is_upper(lexer->lookahead)) {
-                // Upper id: _*[A-Z]...
-                advance(lexer);
-                while (is_id_char(lexer->lookahead)) advance(lexer);
-                lexer->mark_end(lexer);
-
-                if (try_module_prefix_tail(lexer, valid)) {
-                    lexer->result_symbol = MODULE_PREFIX;
-                    return true;
-                }
-
-                // Check for "Fn" keyword
-                // (unlikely with leading underscore, but consistent)
-                lexer->result_symbol = UPPER_ID;
-                return true;
-            }
-
-            if (is_lower(lexer->lookahead)) {
-                // Lower id: _*[a-z]...
-                advance(lexer);
-                while (is_id_char(lexer->lookahead)) advance(lexer);
-                lexer->mark_end(lexer);
-                lexer->result_symbol = LOWER_ID;
-                return true;
-            }
-
-            // Just underscore(s) — return UNDERSCORE
-            if (valid[UNDERSCORE]) {
-                lexer->result_symbol = UNDERSCORE;
-                return true;
-            }
-            return false;
-        }
-
-        // Starts with uppercase letter
-        enum TokenType tt = scan_upper_id(lexer, valid);
-        if (tt != TOKEN_COUNT && valid[tt]) {
-            lexer->result_symbol = tt;
-            return true;
-        }
-        return false;
-    }
-
-    if (is_lower(c)) {
-        enum TokenType tt = scan_lower_id_or_keyword(lexer, scanner, valid);
-        if (tt != TOKEN_COUNT && valid[tt]) {
-            lexer->result_symbol = tt;
-            return true;
-        }
-        return false;
+    // Dispatch on the first character
+    if (c >= 0 && c < 128 && token_handlers[c] != NULL) {
+        return token_handlers[c](scanner, lexer, valid);
     }
 
-    // Digits
-    if (is_digit(c) && valid[INT_LITERAL]) {
-        if (scan_int_literal(lexer)) {
-            lexer->mark_end(lexer);
-            lexer->result_symbol = INT_LITERAL;
-            return true;
-        }
-        return false;
-    }
-
-    // Operators and punctuation
-    // Handle multi-character operators first (longest match)
-
-    if (c == '=') {
-        advance(lexer);
-        if (lexer->lookahead == '=' && valid[EQEQ]) {
-            advance(lexer);
-            lexer->result_symbol = EQEQ;
-            return true;
-        }
-        if (valid[EQ]) {
-            lexer->result_symbol = EQ;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '!') {
-        advance(lexer);
-        if (lexer->lookahead == '=' && valid[NEQ]) {
-            advance(lexer);
-            lexer->result_symbol = NEQ;
-            return true;
-        }
-        if (valid[EXCLAMATION]) {
-            lexer->result_symbol = EXCLAMATION;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '<') {
-        advance(lexer);
-        if (lexer->lookahead == '<' && valid[LSHIFT]) {
-            advance(lexer);
-            lexer->result_symbol = LSHIFT;
-            return true;
-        }
-        if (lexer->lookahead == '=' && valid[LTEQ]) {
-            advance(lexer);
-            lexer->result_symbol = LTEQ;
-            return true;
-        }
-        if (valid[LT]) {
-            lexer->result_symbol = LT;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '>') {
-        advance(lexer);
-        if (lexer->lookahead == '>' && valid[RSHIFT]) {
-            advance(lexer);
-            lexer->result_symbol = RSHIFT;
-            return true;
-        }
-        if (lexer->lookahead == '=' && valid[GTEQ]) {
-            advance(lexer);
-            lexer->result_symbol = GTEQ;
-            return true;
-        }
-        if (valid[GT]) {
-            lexer->result_symbol = GT;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '+') {
-        advance(lexer);
-        if (lexer->lookahead == '=' && valid[PLUSEQ]) {
-            advance(lexer);
-            lexer->result_symbol = PLUSEQ;
-            return true;
-        }
-        if (valid[PLUS]) {
-            lexer->result_symbol = PLUS;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '-') {
-        advance(lexer);
-        if (lexer->lookahead == '=' && valid[MINUSEQ]) {
-            advance(lexer);
-            lexer->result_symbol = MINUSEQ;
-            return true;
-        }
-        if (valid[MINUS]) {
-            lexer->result_symbol = MINUS;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '*') {
-        advance(lexer);
-        if (lexer->lookahead == '=' && valid[STAREQ]) {
-            advance(lexer);
-            lexer->result_symbol = STAREQ;
-            return true;
-        }
-        if (valid[STAR]) {
-            lexer->result_symbol = STAR;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '^') {
-        advance(lexer);
-        if (lexer->lookahead == '=' && valid[CARETEQ]) {
-            advance(lexer);
-            lexer->result_symbol = CARETEQ;
-            return true;
-        }
-        if (valid[CARET]) {
-            lexer->result_symbol = CARET;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '&') {
-        advance(lexer);
-        if (lexer->lookahead == '&' && valid[AMPAMP]) {
-            advance(lexer);
-            lexer->result_symbol = AMPAMP;
-            return true;
-        }
-        if (valid[AMP]) {
-            lexer->result_symbol = AMP;
-            return true;
-        }
-        return false;
-    }
-
-    if (c == '.') {
-        advance(lexer);
-        if (lexer->lookahead == '.' && valid[DOTDOT]) {
-            advance(lexer);
-            lexer->result_symbol = DOTDOT;
-            return true;
-        }
-        if (valid[DOT]) {
-            lexer->result_symbol = DOT;
-            return true;
-        }
-        return false;
-    }
-
-    // Simple single-character tokens
-    if (c == '|' && valid[PIPE]) { advance(lexer); lexer->result_symbol = PIPE; return true; }
-    if (c == '~' && valid[TILDE]) { advance(lexer); lexer->result_symbol = TILDE; return true; }
-    if (c == '/' && valid[SLASH]) { advance(lexer); lexer->result_symbol = SLASH; return true; }
-    if (c == '%' && valid[PERCENT]) { advance(lexer); lexer->result_symbol = PERCENT; return true; }
-    if (c == ':' && valid[COLON]) { advance(lexer); lexer->result_symbol = COLON; return true; }
-    if (c == ',' && valid[COMMA]) { advance(lexer); lexer->result_symbol = COMMA; return true; }
-    if (c == ';' && valid[SEMICOLON]) { advance(lexer); lexer->result_symbol = SEMICOLON; return true; }
-
     return false;
 }
 
 // ==================== Tree-sitter API ====================
 
 void *tree_sitter_fir_external_scanner_create(void) {
-    Scanner *scanner = calloc(1, sizeof(Scanner));
-    scanner->depth = 1;
-    scanner->stack[0].kind = FRAME_INDENTED;
-    scanner->stack[0].block_col = 0;
+    Scanner *scanner = ts_calloc(1, sizeof(Scanner));
+    array_init(&scanner->stack);
+    array_reserve(&scanner->stack, INITIAL_STACK_CAPACITY);
+    reset(scanner);
     return scanner;
 }
 
 void tree_sitter_fir_external_scanner_destroy(void *payload) {
-    free(payload);
+    Scanner *scanner = (Scanner *)payload;
+    array_delete(&scanner->stack);
+    ts_free(scanner);
+}
+
+static inline uint32_t zigzag_encode(int32_t n) {
+    return ((uint32_t)n << 1) ^ (uint32_t)(n >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t n) {
+    return (int32_t)(n >> 1) ^ -(int32_t)(n & 1);
 }
 
 unsigned tree_sitter_fir_external_scanner_serialize(void *payload, char *buffer) {
     Scanner *scanner = (Scanner *)payload;
+
+    uint8_t flags = 0;
+    if (scanner->in_string) flags |= STATE_IN_STRING;
+    if (scanner->eof_newline_emitted) flags |= STATE_EOF_NEWLINE_EMITTED;
+    if (scanner->pending_end_blocks > 0) flags |= STATE_PENDING_END_BLOCKS;
+
+    if (flags == 0 && depth(scanner) == 1) {
+        return 0;
+    }
+
     unsigned pos = 0;
+    buffer[pos++] = (char)flags;
+    if (flags & STATE_PENDING_END_BLOCKS) {
+        buffer[pos++] = (char)scanner->pending_end_blocks;
+    }
+
+    uint16_t prev_col = 0;
+    for (uint32_t i = 1; i < depth(scanner); i++) {
+        Frame frame = scanner->stack.contents[i];
+        if (frame.kind != FRAME_INDENTED) {
+            buffer[pos++] = (char)frame.kind;
+            continue;
+        }
 
-    buffer[pos++] = (char)scanner->depth;
-    buffer[pos++] = (char)scanner->pending_end_blocks;
-    buffer[pos++] = (char)scanner->in_string;
-    buffer[pos++] = (char)scanner->eof_newline_emitted;
+        uint32_t delta = zigzag_encode((int32_t)frame.block_col - (int32_t)prev_col);
+        prev_col = frame.block_col;
+        if (delta < FRAME_DELTA_ESCAPE) {
+            buffer[pos++] = (char)(FRAME_INDENTED | (delta << FRAME_KIND_BITS));
+            continue;
+        }
 
-    for (uint8_t i = 0; i < scanner->depth && pos + 3 <= TREE_SITTER_SERIALIZATION_BUFFER_SIZE; i++) {
-        buffer[pos++] = (char)scanner->stack[i].kind;
-        buffer[pos++] = (char)(scanner->stack[i].block_col & 0xFF);
-        buffer[pos++] = (char)((scanner->stack[i].block_col >> 8) & 0xFF);
+        buffer[pos++] = (char)(FRAME_INDENTED | (FRAME_DELTA_ESCAPE << FRAME_KIND_BITS));
+        while (delta >= 0x80) {
+            buffer[pos++] = (char)(0x80 | (delta & 0x7F));
+            delta >>= 7;
+        }
+        buffer[pos++] = (char)delta;
     }
 
     return pos;
@@ -1120,30 +1135,57 @@ unsigned tree_sitter_fir_external_scanner_serialize(void *payload, char *buffer)
 void tree_sitter_fir_external_scanner_deserialize(void *payload, const char *buffer, unsigned length) {
     Scanner *scanner = (Scanner *)payload;
 
+    reset(scanner);
+
     if (length == 0) {
-        scanner->depth = 1;
-        scanner->stack[0].kind = FRAME_INDENTED;
-        scanner->stack[0].block_col = 0;
-        scanner->pending_end_blocks = 0;
-        scanner->in_string = false;
-        scanner->eof_newline_emitted = false;
         return;
     }
 
     unsigned pos = 0;
-    scanner->depth = (uint8_t)buffer[pos++];
-    scanner->pending_end_blocks = (uint8_t)buffer[pos++];
-    scanner->in_string = (bool)buffer[pos++];
-    scanner->eof_newline_emitted = (bool)buffer[pos++];
-
-    for (uint8_t i = 0; i < scanner->depth && pos + 3 <= length; i++) {
-        scanner->stack[i].kind = (FrameKind)buffer[pos++];
-        scanner->stack[i].block_col = (uint16_t)((unsigned char)buffer[pos] | ((unsigned char)buffer[pos + 1] << 8));
-        pos += 2;
+    uint8_t flags = (uint8_t)buffer[pos++];
+    scanner->in_string = (flags & STATE_IN_STRING) != 0;
+    scanner->eof_newline_emitted = (flags & STATE_EOF_NEWLINE_EMITTED) != 0;
+    if ((flags & STATE_PENDING_END_BLOCKS) && pos < length) {
+        scanner->pending_end_blocks = (uint8_t)buffer[pos++];
+    }
+
+    uint16_t prev_col = 0;
+    while (pos < length && depth(scanner) < MAX_DEPTH) {
+        uint8_t entry = (uint8_t)buffer[pos++];
+        FrameKind kind = (FrameKind)(entry & FRAME_KIND_MASK);
+        if (kind != FRAME_INDENTED) {
+            array_push(&scanner->stack, ((Frame){.kind = kind, .block_col = 0}));
+            continue;
+        }
+
+        uint32_t delta = entry >> FRAME_KIND_BITS;
+        if (delta == FRAME_DELTA_ESCAPE) {
+            delta = 0;
+            for (unsigned shift = 0; pos < length && shift < 32; shift += 7) {
+                uint8_t byte = (uint8_t)buffer[pos++];
+                delta |= (uint32_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) break;
+            }
+        }
+        prev_col = (uint16_t)((int32_t)prev_col + zigzag_decode(delta));
+        array_push(&scanner->stack, ((Frame){.kind = FRAME_INDENTED, .block_col = prev_col}));
     }
 }
 
 bool tree_sitter_fir_external_scanner_scan(void *payload, TSLexer *lexer, const bool *valid_symbols) {
     Scanner *scanner = (Scanner *)payload;
+#ifdef FIR_SCANNER_STATS
+    stats.scans++;
+    stats.depth_histogram[depth(scanner) <= MAX_DEPTH ? depth(scanner) : MAX_DEPTH]++;
+    stats_section = SECTION_PENDING;
+    bool found = scan(scanner, lexer, valid_symbols);
+    if (found) {
+        stats.tokens[lexer->result_symbol]++;
+    } else {
+        stats.failed_scans++;
+    }
+    return found;
+#else
     return scan(scanner, lexer, valid_symbols);
+#endif
 }
@@ -4,6 +4,27 @@ shopt -s globstar
 
 FILE="${1:-../fir}"
 
+# With FIR_VALIDATE=1, use the native validator (test/validate.c) instead of
+# the CLI: it parses in process, on all cores, and skips files whose results
+# are cached for the same content and grammar. It must be built from the
+# current sources (bench/build.sh).
+if [ "$FIR_VALIDATE" = 1 ]; then
+    ROOT="$(dirname "$0")"
+    VALIDATE="$ROOT/bench/build/validate"
+    if [ ! -x "$VALIDATE" ]; then
+        echo "$VALIDATE is not built; run bench/build.sh" >&2
+        exit 1
+    fi
+    for source in "$ROOT"/src/parser.c "$ROOT"/src/scanner.c "$ROOT"/test/validate.c "$ROOT"/test/cache.h \
+                  "$ROOT"/bench/corpus.h; do
+        if [ "$source" -nt "$VALIDATE" ]; then
+            echo "$VALIDATE is older than $source; run bench/build.sh" >&2
+            exit 1
+        fi
+    done
+    exec "$VALIDATE" -c "$ROOT/bench/build/validate.cache" "$FILE"
+fi
+
 pass=0
 fail=0
 
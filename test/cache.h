@@ -0,0 +1,219 @@
+// On-disk cache of validation results, keyed by file content.
+//
+// The cache file has a header with the grammar fingerprint (a hash of
+// src/parser.c and src/scanner.c, passed in by build.sh as
+// FIR_GRAMMAR_FINGERPRINT) and a hash of the tags query (0 without one),
+// followed by fixed-size entries sorted by key, and then the tags of all
+// entries. Each entry refers to a run of the tags. The file is memory-mapped
+// and searched with binary search, so looking up a file costs a hash of its
+// content and no parsing. A cache with a different fingerprint, tags query or
+// version is ignored, and rewritten after the run. The rewritten cache only
+// has the files of the run, so entries for old versions of edited files and
+// for removed files don't pile up.
+
+#ifndef FIR_CACHE_H_
+#define FIR_CACHE_H_
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "FIRCACHE"
+#define CACHE_VERSION 2
+#define CACHE_FINGERPRINT_SIZE 32
+
+// Error ranges stored per file. A file with more errors stores the first ones.
+#define CACHE_MAX_ERRORS 8
+
+typedef struct {
+    uint64_t hash;
+    uint64_t length;
+} CacheKey;
+
+typedef struct {
+    uint32_t start_byte;
+    uint32_t end_byte;
+    uint32_t row;
+    uint32_t column;
+} CacheRange;
+
+// A tag: the range of its name, and the capture of the tags query that gives
+// its kind (e.g. @definition.function).
+typedef struct {
+    uint32_t capture;
+    uint32_t start_byte;
+    uint32_t end_byte;
+    uint32_t row;
+    uint32_t column;
+} CacheTag;
+
+typedef struct {
+    CacheKey key;
+    uint32_t kind;  // ResultKind in validate.c
+    uint32_t end_row;
+    uint32_t lines;
+    uint32_t error_count;
+    CacheRange errors[CACHE_MAX_ERRORS];
+    uint32_t tag_start;  // index of the first tag, in the cache or in the run
+    uint32_t tag_count;
+} CacheEntry;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    char fingerprint[CACHE_FINGERPRINT_SIZE];
+    uint64_t tags_hash;
+    uint32_t tag_count;
+    uint32_t padding;
+} CacheHeader;
+
+typedef struct {
+    void *map;
+    size_t size;
+    const CacheEntry *entries;
+    uint32_t count;
+    const CacheTag *tags;
+} Cache;
+
+// 64-bit FNV-1a. The key also has the length, so a collision needs two files of
+// the same length.
+static inline CacheKey cache_key(const char *source, uint32_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)source[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return (CacheKey){hash, length};
+}
+
+typedef struct {
+    const CacheTag *tags;
+    uint32_t count;
+} CacheTagRun;
+
+static inline int cache__compare_keys(CacheKey a, CacheKey b) {
+    if (a.hash != b.hash) return a.hash < b.hash ? -1 : 1;
+    if (a.length != b.length) return a.length < b.length ? -1 : 1;
+    return 0;
+}
+
+static inline int cache__compare_entries(const void *a, const void *b) {
+    return cache__compare_keys(((const CacheEntry *)a)->key, ((const CacheEntry *)b)->key);
+}
+
+static inline void cache_close(Cache *cache) {
+    if (cache->map) munmap(cache->map, cache->size);
+    *cache = (Cache){0};
+}
+
+// Map the cache at `path`. Returns false (and leaves `cache` empty) if there is
+// no usable cache.
+static inline bool cache_open(Cache *cache, const char *path, const char *fingerprint, uint64_t tags_hash) {
+    *cache = (Cache){0};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const CacheHeader *header = map;
+    if (memcmp(header->magic, CACHE_MAGIC, 8) != 0 || header->version != CACHE_VERSION ||
+        strncmp(header->fingerprint, fingerprint, CACHE_FINGERPRINT_SIZE) != 0 || header->tags_hash != tags_hash ||
+        sizeof(CacheHeader) + (size_t)header->count * sizeof(CacheEntry) +
+                (size_t)header->tag_count * sizeof(CacheTag) >
+            (size_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        return false;
+    }
+    cache->map = map;
+    cache->size = (size_t)st.st_size;
+    cache->entries = (const CacheEntry *)(header + 1);
+    cache->count = header->count;
+    cache->tags = (const CacheTag *)(cache->entries + header->count);
+    for (uint32_t i = 0; i < cache->count; i++) {
+        const CacheEntry *entry = &cache->entries[i];
+        if (entry->tag_start > header->tag_count || entry->tag_count > header->tag_count - entry->tag_start) {
+            cache_close(cache);
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline const CacheEntry *cache_lookup(const Cache *cache, CacheKey key) {
+    uint32_t low = 0, high = cache->count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        int order = cache__compare_keys(cache->entries[mid].key, key);
+        if (order == 0) return &cache->entries[mid];
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return NULL;
+}
+
+// Write `entries` (which are sorted in place) to `path`, through a temporary
+// file. Their tags are in `tags`. Entries with the same key (identical files)
+// are written once.
+static inline bool cache_write(const char *path, const char *fingerprint, uint64_t tags_hash, CacheEntry *entries,
+                               uint32_t count, const CacheTag *tags) {
+    qsort(entries, count, sizeof(CacheEntry), cache__compare_entries);
+
+    size_t path_length = strlen(path);
+    char *tmp_path = malloc(path_length + 5);
+    memcpy(tmp_path, path, path_length);
+    memcpy(tmp_path + path_length, ".tmp", 5);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(tmp_path);
+        return false;
+    }
+
+    CacheHeader header = {.version = CACHE_VERSION, .tags_hash = tags_hash};
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    strncpy(header.fingerprint, fingerprint, CACHE_FINGERPRINT_SIZE);
+    fwrite(&header, sizeof header, 1, f);
+
+    // Remember where each written entry's tags are.
+    CacheTagRun *runs = malloc((count ? count : 1) * sizeof(CacheTagRun));
+    uint32_t written = 0, tag_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const CacheEntry *entry = &entries[i];
+        if (written > 0 && cache__compare_keys(entry->key, entries[i - 1].key) == 0) continue;
+        CacheEntry copy = *entry;
+        runs[written] = (CacheTagRun){tags + entry->tag_start, entry->tag_count};
+        copy.tag_start = tag_count;
+        tag_count += copy.tag_count;
+        fwrite(&copy, sizeof copy, 1, f);
+        written++;
+    }
+    for (uint32_t k = 0; k < written; k++) {
+        fwrite(runs[k].tags, sizeof(CacheTag), runs[k].count, f);
+    }
+    free(runs);
+
+    header.count = written;
+    header.tag_count = tag_count;
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof header, 1, f);
+    bool ok = fclose(f) == 0 && rename(tmp_path, path) == 0;
+    free(tmp_path);
+    return ok;
+}
+
+#endif // FIR_CACHE_H_
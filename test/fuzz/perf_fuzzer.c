@@ -0,0 +1,82 @@
+// libFuzzer harness that looks for slow inputs instead of crashes.
+//
+// Build (needs clang and a static tree-sitter runtime):
+//
+//   clang -O2 -g -fsanitize=fuzzer -Isrc $(pkg-config --cflags tree-sitter)
+//       test/fuzz/perf_fuzzer.c src/parser.c src/scanner.c
+//       $(pkg-config --libs tree-sitter) -o perf_fuzzer
+//
+// AFL++ builds the same harness with `afl-clang-fast -fsanitize=fuzzer`.
+//
+// Run with the regression corpus as seeds, and a dictionary of Fir tokens:
+//
+//   ./perf_fuzzer -dict=test/fuzz/fir.dict -max_len=65536 new_inputs test/perf
+//
+// Each input is parsed, and the parse time is compared with a budget of
+// FIR_PERF_BASE_US (default: 2000) microseconds plus FIR_PERF_NS_PER_BYTE
+// (default: 2000) nanoseconds per byte of input. An input over the budget is
+// reported as a crash, so libFuzzer saves it. Minimize it with
+// `./perf_fuzzer -minimize_crash=1 -runs=10000 crash-...`, which keeps the
+// input over the budget while making it smaller, and add the result to
+// test/perf.
+//
+// The default budget is far above the normal parse time (tens of ns per
+// byte), so only super-linear behaviour in the scanner or the parser trips
+// it, not noise.
+
+#include <tree_sitter/api.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+static TSParser *parser;
+static double base_seconds = 2000e-6;
+static double seconds_per_byte = 2000e-9;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+    (void)argc;
+    (void)argv;
+    const char *base = getenv("FIR_PERF_BASE_US");
+    const char *per_byte = getenv("FIR_PERF_NS_PER_BYTE");
+    if (base) base_seconds = atof(base) * 1e-6;
+    if (per_byte) seconds_per_byte = atof(per_byte) * 1e-9;
+
+    parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size > UINT32_MAX) return 0;
+
+    double start = now();
+    TSTree *tree = ts_parser_parse_string(parser, NULL, (const char *)data, (uint32_t)size);
+    double elapsed = now() - start;
+    ts_tree_delete(tree);
+
+    double budget = base_seconds + seconds_per_byte * (double)size;
+    if (elapsed > budget) {
+        // Parse again to filter out one-off stalls (e.g. the fuzzer process
+        // being descheduled).
+        start = now();
+        tree = ts_parser_parse_string(parser, NULL, (const char *)data, (uint32_t)size);
+        elapsed = now() - start;
+        ts_tree_delete(tree);
+        if (elapsed > budget) {
+            fprintf(stderr, "slow input: %zu bytes parsed in %.3f ms (budget %.3f ms)\n", size,
+                    elapsed * 1e3, budget * 1e3);
+            abort();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,250 @@
+// Checks that parse time grows linearly with the input size.
+//
+// Usage: bench/build/growth [-m BYTES] [-x EXPONENT] [-o DIR] [FAMILY...]
+//
+// For each family of generated inputs (all of them by default), parses inputs
+// of doubling size, up to BYTES (default: 1 MB), and fits the growth of the
+// parse time (best of 3) to bytes^k between consecutive sizes. A family fails
+// if k is above EXPONENT (default: 1.5) between two sizes where the parse takes
+// at least a millisecond, e.g. because the scanner loops over the frame stack
+// on every token or the parser forks on every token. With -o, the smallest
+// input of each failing family is written to DIR, to be added to the
+// regression corpus in test/perf.
+//
+// Prints the time per byte at each size, and exits with status 1 if any family
+// failed.
+
+#include <tree_sitter/api.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+// Only time differences above this are used for the exponent.
+#define MIN_SECONDS 1e-3
+
+typedef struct {
+    char *data;
+    uint32_t length;
+    uint32_t capacity;
+} Buffer;
+
+static void append(Buffer *b, const char *s) {
+    uint32_t n = (uint32_t)strlen(s);
+    if (b->length + n + 1 > b->capacity) {
+        while (b->length + n + 1 > b->capacity) b->capacity = b->capacity ? b->capacity * 2 : 4096;
+        b->data = realloc(b->data, b->capacity);
+    }
+    memcpy(b->data + b->length, s, n + 1);
+    b->length += n;
+}
+
+static void append_repeat(Buffer *b, const char *s, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) append(b, s);
+}
+
+static void append_indent(Buffer *b, uint32_t columns) {
+    for (uint32_t i = 0; i < columns; i++) append(b, " ");
+}
+
+// ==================== Families ====================
+
+// Independent functions: the baseline.
+static void gen_declarations(Buffer *b, uint32_t n) {
+    char line[64];
+    for (uint32_t i = 0; i < n; i++) {
+        snprintf(line, sizeof line, "f%u(x: I32) I32:\n    x + %u\n\n", i, i);
+        append(b, line);
+    }
+}
+
+// Nested parentheses. Past the scanner's frame limit this is a parse error.
+static void gen_brackets(Buffer *b, uint32_t n) {
+    append(b, "main():\n    f(");
+    append_repeat(b, "(", n);
+    append(b, "1");
+    append_repeat(b, ")", n);
+    append(b, ")\n");
+}
+
+// Nested blocks of depth n closed by one dedent to column 0, repeated.
+static void gen_dedents(Buffer *b, uint32_t n) {
+    uint32_t nesting = n < 200 ? n : 200;
+    for (uint32_t repeat = 0; repeat < n / nesting; repeat++) {
+        append(b, "main():\n");
+        for (uint32_t i = 1; i <= nesting; i++) {
+            append_indent(b, 4 * i);
+            append(b, "if x:\n");
+        }
+        append_indent(b, 4 * (nesting + 1));
+        append(b, "y\n");
+    }
+}
+
+// Nested block comments.
+static void gen_block_comments(Buffer *b, uint32_t n) {
+    append_repeat(b, "#| a ", n);
+    append_repeat(b, "|#", n);
+    append(b, "\nmain():\n    1\n");
+}
+
+// A long chain of binary operators.
+static void gen_operators(Buffer *b, uint32_t n) {
+    append(b, "main():\n    let x = 1");
+    append_repeat(b, " + 1 * 2", n);
+    append(b, "\n");
+}
+
+// A string with many interpolations.
+static void gen_interpolations(Buffer *b, uint32_t n) {
+    append(b, "main():\n    print(\"");
+    append_repeat(b, "a `x` ", n);
+    append(b, "\")\n");
+}
+
+// Unclosed calls, one per line, for error recovery.
+static void gen_unclosed(Buffer *b, uint32_t n) {
+    append(b, "main():\n");
+    append_repeat(b, "    f(x,\n", n);
+}
+
+typedef struct {
+    const char *name;
+    void (*generate)(Buffer *b, uint32_t n);
+    uint32_t start;
+} Family;
+
+static const Family families[] = {
+    {"declarations", gen_declarations, 64},
+    {"brackets", gen_brackets, 16},
+    {"dedents", gen_dedents, 16},
+    {"block_comments", gen_block_comments, 64},
+    {"operators", gen_operators, 64},
+    {"interpolations", gen_interpolations, 64},
+    {"unclosed", gen_unclosed, 64},
+};
+
+#define FAMILY_COUNT (sizeof(families) / sizeof(families[0]))
+
+// ==================== Timing ====================
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double time_parse(TSParser *parser, const Buffer *input) {
+    double best = 0;
+    for (int i = 0; i < 3; i++) {
+        double start = now();
+        TSTree *tree = ts_parser_parse_string(parser, NULL, input->data, input->length);
+        double elapsed = now() - start;
+        ts_tree_delete(tree);
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static void write_input(const char *dir, const char *name, const Buffer *input) {
+    char path[4096];
+    snprintf(path, sizeof path, "%s/%s.fir", dir, name);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "warning: can't write %s\n", path);
+        return;
+    }
+    fwrite(input->data, 1, input->length, f);
+    fclose(f);
+    printf("  wrote %s (%u bytes)\n", path, input->length);
+}
+
+// Returns false if the family grows faster than `max_exponent`.
+static bool check_family(TSParser *parser, const Family *family, uint32_t max_bytes, double max_exponent,
+                         const char *out_dir) {
+    printf("%s:\n", family->name);
+    bool ok = true;
+    double last_time = 0;
+    uint32_t last_bytes = 0;
+    for (uint32_t n = family->start;; n *= 2) {
+        Buffer input = {0};
+        family->generate(&input, n);
+        if (input.length > max_bytes) {
+            free(input.data);
+            break;
+        }
+        double time = time_parse(parser, &input);
+        printf("  %10u bytes %10.3f ms %8.1f ns/byte", input.length, time * 1e3, time * 1e9 / input.length);
+
+        if (last_time >= MIN_SECONDS) {
+            double exponent = log(time / last_time) / log((double)input.length / last_bytes);
+            printf("   k = %.2f", exponent);
+            if (exponent > max_exponent) {
+                printf("  super-linear\n");
+                // The first size that shows it is the smallest reproducer.
+                if (ok && out_dir) write_input(out_dir, family->name, &input);
+                ok = false;
+                free(input.data);
+                continue;
+            }
+        }
+        printf("\n");
+        last_time = time;
+        last_bytes = input.length;
+        free(input.data);
+    }
+    return ok;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-m BYTES] [-x EXPONENT] [-o DIR] [FAMILY...]\n", program);
+}
+
+int main(int argc, char **argv) {
+    uint32_t max_bytes = 1 << 20;
+    double max_exponent = 1.5;
+    const char *out_dir = NULL;
+    bool selected[FAMILY_COUNT] = {false};
+    bool any_selected = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            max_bytes = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            max_exponent = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            size_t f = 0;
+            while (f < FAMILY_COUNT && strcmp(families[f].name, argv[i]) != 0) f++;
+            if (f == FAMILY_COUNT) {
+                fprintf(stderr, "error: unknown family %s\n", argv[i]);
+                return 2;
+            }
+            selected[f] = true;
+            any_selected = true;
+        }
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+
+    uint32_t failed = 0;
+    for (size_t f = 0; f < FAMILY_COUNT; f++) {
+        if (any_selected && !selected[f]) continue;
+        if (!check_family(parser, &families[f], max_bytes, max_exponent, out_dir)) failed++;
+    }
+    printf("%u families super-linear\n", failed);
+
+    ts_parser_delete(parser);
+    return failed > 0 ? 1 : 0;
+}
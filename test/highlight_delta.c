@@ -0,0 +1,262 @@
+// Checks for `fir_highlight_delta` (lib/fir_highlight.h).
+//
+// Usage: bench/build/highlight_delta
+//
+// Reparses a small file after edits that keep the shape of the tree (renaming
+// identifiers, with the same and a different length, and two renames in one
+// update) and after one that changes it, and checks that the ranges of the
+// delta cover the edited text, stay within the edited declarations, and that
+// the captures that differ are reported. Prints each failed check and exits
+// with status 1 if any failed.
+
+#include "fir_highlight.h"
+
+#include <tree_sitter/api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+static const char source[] =
+    "first(a: I32) I32:\n"
+    "    a\n"
+    "\n"
+    "second(count: I32) I32:\n"
+    "    print(count)\n"
+    "    count\n"
+    "\n"
+    "third():\n"
+    "    print(1)\n";
+
+static const char query_source[] =
+    "(call_expression (variable_expression (lower_id) @function))\n"
+    "(lower_id) @variable\n";
+
+static int failures = 0;
+
+#define CHECK(condition, ...)                 \
+    do {                                      \
+        if (!(condition)) {                   \
+            printf("FAIL %s: ", test_name);   \
+            printf(__VA_ARGS__);              \
+            printf("\n");                     \
+            failures++;                       \
+        }                                     \
+    } while (0)
+
+typedef struct {
+    char *text;
+    uint32_t length;
+} Document;
+
+static TSPoint point_at(const Document *doc, uint32_t byte) {
+    TSPoint point = {0, 0};
+    for (uint32_t i = 0; i < byte; i++) {
+        if (doc->text[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
+    }
+    return point;
+}
+
+// Replace the first occurrence of `old_text` at or after `from` with
+// `new_text`, and describe the edit for `ts_tree_edit`.
+static TSInputEdit replace(Document *doc, uint32_t from, const char *old_text, const char *new_text) {
+    const char *found = strstr(doc->text + from, old_text);
+    if (found == NULL) {
+        fprintf(stderr, "error: no \"%s\" in the test source\n", old_text);
+        exit(2);
+    }
+    uint32_t start = (uint32_t)(found - doc->text);
+    uint32_t old_length = (uint32_t)strlen(old_text), new_length = (uint32_t)strlen(new_text);
+    TSInputEdit edit = {
+        .start_byte = start,
+        .old_end_byte = start + old_length,
+        .new_end_byte = start + new_length,
+        .start_point = point_at(doc, start),
+        .old_end_point = point_at(doc, start + old_length),
+    };
+    char *text = malloc(doc->length - old_length + new_length + 1);
+    memcpy(text, doc->text, start);
+    memcpy(text + start, new_text, new_length);
+    memcpy(text + start + new_length, found + old_length, doc->length - edit.old_end_byte + 1);
+    free(doc->text);
+    doc->text = text;
+    doc->length = doc->length - old_length + new_length;
+    edit.new_end_point = point_at(doc, edit.new_end_byte);
+    return edit;
+}
+
+static bool covered(const FirHighlightDelta *delta, uint32_t start, uint32_t end) {
+    for (uint32_t i = 0; i < delta->range_count; i++) {
+        if (delta->ranges[i].start_byte <= start && end <= delta->ranges[i].end_byte) return true;
+    }
+    return false;
+}
+
+static bool overlaps(const FirHighlightDelta *delta, uint32_t start, uint32_t end) {
+    for (uint32_t i = 0; i < delta->range_count; i++) {
+        if (delta->ranges[i].start_byte < end && start < delta->ranges[i].end_byte) return true;
+    }
+    return false;
+}
+
+typedef struct {
+    TSParser *parser;
+    TSQuery *query;
+    TSQueryCursor *cursor;
+    Document doc;
+    TSTree *old_tree;
+    TSTree *new_tree;
+    TSInputEdit edits[4];
+    uint32_t edit_count;
+    FirHighlightDelta delta;
+} Test;
+
+static void start(Test *test) {
+    test->doc.length = (uint32_t)strlen(source);
+    test->doc.text = malloc(test->doc.length + 1);
+    memcpy(test->doc.text, source, test->doc.length + 1);
+    test->old_tree = ts_parser_parse_string(test->parser, NULL, test->doc.text, test->doc.length);
+    test->edit_count = 0;
+}
+
+static void edit(Test *test, uint32_t from, const char *old_text, const char *new_text) {
+    TSInputEdit edit = replace(&test->doc, from, old_text, new_text);
+    ts_tree_edit(test->old_tree, &edit);
+    test->edits[test->edit_count++] = edit;
+}
+
+static void reparse(Test *test) {
+    test->new_tree = ts_parser_parse_string(test->parser, test->old_tree, test->doc.text, test->doc.length);
+    fir_highlight_delta(test->query, test->cursor, test->old_tree, test->new_tree, test->edits, test->edit_count,
+                        &test->delta);
+}
+
+static void finish(Test *test) {
+    fir_highlight_delta_delete(&test->delta);
+    ts_tree_delete(test->old_tree);
+    ts_tree_delete(test->new_tree);
+    free(test->doc.text);
+}
+
+static uint32_t offset_of(const Test *test, const char *text) {
+    return (uint32_t)(strstr(test->doc.text, text) - test->doc.text);
+}
+
+// The start of the declaration `name`, and the start of the next one (or the
+// end of the file).
+static void declaration(const Test *test, const char *name, uint32_t *start, uint32_t *end) {
+    *start = offset_of(test, name);
+    const char *next = strstr(test->doc.text + *start, "\n\n");
+    *end = next ? (uint32_t)(next - test->doc.text) + 2 : test->doc.length;
+}
+
+static void check_trees_have_no_errors(Test *test, const char *test_name) {
+    CHECK(!ts_node_has_error(ts_tree_root_node(test->new_tree)), "the edited source has parse errors");
+}
+
+// A rename with the same length: the tree keeps its shape and its positions.
+static void test_same_length_rename(Test *test) {
+    const char *test_name = "same-length rename";
+    start(test);
+    uint32_t body = offset_of(test, "    print(count)");
+    edit(test, body, "count", "total");
+    reparse(test);
+    check_trees_have_no_errors(test, test_name);
+
+    uint32_t name = test->edits[0].start_byte, second, third;
+    declaration(test, "second", &second, &third);
+    CHECK(covered(&test->delta, name, name + 5), "the renamed identifier at byte %u isn't in the ranges", name);
+    CHECK(covered(&test->delta, second, third - 2), "the ranges don't cover the whole declaration");
+    CHECK(!overlaps(&test->delta, 0, second - 1), "the ranges reach into the previous declaration");
+    CHECK(!overlaps(&test->delta, third, test->doc.length), "the ranges reach into the next declaration");
+    CHECK(test->delta.change_count == 0, "%u captures changed, expected none", test->delta.change_count);
+    finish(test);
+}
+
+// A longer name: the positions after it move.
+static void test_longer_rename(Test *test) {
+    const char *test_name = "longer rename";
+    start(test);
+    edit(test, offset_of(test, "    a\n") + 4, "a", "alpha");
+    reparse(test);
+    check_trees_have_no_errors(test, test_name);
+
+    uint32_t name = test->edits[0].start_byte, second, third;
+    declaration(test, "second", &second, &third);
+    CHECK(covered(&test->delta, name, name + 5), "the renamed identifier at byte %u isn't in the ranges", name);
+    CHECK(!overlaps(&test->delta, second, test->doc.length), "the ranges reach into the next declarations");
+    finish(test);
+}
+
+// Two renames in one update, the second before the first and longer, so the
+// first one's range has to be moved in the final source.
+static void test_two_renames(Test *test) {
+    const char *test_name = "two renames";
+    start(test);
+    edit(test, offset_of(test, "third"), "print(1)", "print(2)");
+    edit(test, 0, "first", "the_first");
+    reparse(test);
+    check_trees_have_no_errors(test, test_name);
+
+    uint32_t literal = offset_of(test, "print(2)") + 6, name = offset_of(test, "the_first"), second, third;
+    declaration(test, "second", &second, &third);
+    CHECK(covered(&test->delta, literal, literal + 1), "the first edit, at byte %u, isn't in the ranges", literal);
+    CHECK(covered(&test->delta, name, name + 9), "the second edit isn't in the ranges");
+    CHECK(!overlaps(&test->delta, second, third), "the ranges reach into the declaration between the edits");
+    finish(test);
+}
+
+// An edit that changes the shape: `a` becomes a call, so its capture changes.
+static void test_new_call(Test *test) {
+    const char *test_name = "new call";
+    start(test);
+    edit(test, offset_of(test, "    a\n") + 4, "a", "f(a)");
+    reparse(test);
+    check_trees_have_no_errors(test, test_name);
+
+    uint32_t callee = test->edits[0].start_byte;
+    bool found = false;
+    for (uint32_t i = 0; i < test->delta.change_count; i++) {
+        const FirHighlightChange *change = &test->delta.changes[i];
+        uint32_t length;
+        const char *capture = ts_query_capture_name_for_id(test->query, change->capture, &length);
+        if (change->start_byte == callee && change->end_byte == callee + 1 && change->kind != FIR_HIGHLIGHT_REMOVED &&
+            length == 8 && memcmp(capture, "function", 8) == 0) {
+            found = true;
+        }
+    }
+    CHECK(found, "no @function capture was added for the callee at byte %u", callee);
+    finish(test);
+}
+
+int main(void) {
+    const TSLanguage *language = tree_sitter_fir();
+    uint32_t error_offset;
+    TSQueryError error_type;
+    Test test = {.parser = ts_parser_new()};
+    ts_parser_set_language(test.parser, language);
+    test.query = ts_query_new(language, query_source, (uint32_t)strlen(query_source), &error_offset, &error_type);
+    if (test.query == NULL) {
+        fprintf(stderr, "error: query error %d at byte %u\n", error_type, error_offset);
+        return 2;
+    }
+    test.cursor = ts_query_cursor_new();
+
+    test_same_length_rename(&test);
+    test_longer_rename(&test);
+    test_two_renames(&test);
+    test_new_call(&test);
+
+    ts_query_cursor_delete(test.cursor);
+    ts_query_delete(test.query);
+    ts_parser_delete(test.parser);
+    printf(failures ? "%d checks failed\n" : "All checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,9 @@
+#!/bin/bash
+
+# Checks that the inputs in test/perf, which made the scanner or the parser
+# slow (deep nesting, long runs of dedents, nested block comments), still
+# parse within a time budget. Needs the native validator (bench/build.sh).
+
+cd "$(dirname "$0")/.."
+
+exec bench/build/validate -e -t "${1:-1}" test/perf
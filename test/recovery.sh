@@ -0,0 +1,8 @@
+#!/bin/bash
+
+# Checks that error recovery on the broken inputs in test/recovery finishes
+# quickly. Needs the native validator (bench/build.sh).
+
+cd "$(dirname "$0")/.."
+
+exec bench/build/validate -e -t "${1:-1}" test/recovery
@@ -0,0 +1,468 @@
+// Parallel corpus validator: the native equivalent of test.sh.
+//
+// Usage: bench/build/validate [-j JOBS] [-t SECONDS] [-e] [-c CACHE] [-T QUERY] [PATH]
+//
+// Parses all `.fir` files under PATH (default: ../fir) on JOBS worker threads
+// (default: number of CPUs), each with its own parser. A file fails if its tree
+// has an error, if the tree doesn't cover the whole file (the scanner stopped
+// producing tokens), or if parsing takes longer than SECONDS (default: 5).
+// With -e, errors in the tree are allowed: used with broken inputs to check
+// that error recovery finishes in time.
+// Prints PASS/FAIL per file and a summary like test.sh, and exits with status 1
+// if any file failed.
+//
+// With -T (e.g. -T queries/tags.scm), also extracts the tags of each file with
+// the QUERY: every match with a @name capture and a @definition.* or
+// @reference.* capture. They are printed under the file's PASS/FAIL line.
+//
+// With -c, results are cached in the file CACHE (see cache.h), keyed by the
+// content of each file and the grammar the validator was built with, with the
+// tags if -T is given. Files with a cached result aren't parsed again.
+// Timeouts aren't cached. The cache is rewritten with the files of this run
+// only.
+
+#include "../bench/corpus.h"
+#include "cache.h"
+
+#include <tree_sitter/api.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+// Set by build.sh to a hash of src/parser.c and src/scanner.c. Without it the
+// cache is disabled, as results from other grammar versions can't be told apart.
+#ifndef FIR_GRAMMAR_FINGERPRINT
+#define FIR_GRAMMAR_FINGERPRINT ""
+#endif
+
+#define GREEN "\033[0;32m"
+#define RED "\033[0;31m"
+#define RESET "\033[0m"
+
+typedef enum {
+    RESULT_PASS,
+    RESULT_ERROR,
+    RESULT_PARTIAL,
+    RESULT_TIMEOUT,
+} ResultKind;
+
+typedef struct {
+    ResultKind kind;
+    uint32_t end_row;  // for RESULT_PARTIAL
+    uint32_t lines;    // for RESULT_PARTIAL
+    uint32_t error_count;  // for RESULT_ERROR, may be more than stored
+    CacheRange errors[CACHE_MAX_ERRORS];
+    const CacheTag *tags;  // in the cache if `cached`, otherwise owned
+    uint32_t tag_count;
+    bool cached;
+} Result;
+
+typedef struct {
+    TSQuery *query;
+    uint32_t name_capture;
+    bool *is_kind;  // by capture: @definition.* and @reference.*
+    uint64_t hash;  // of the query source
+} Tags;
+
+typedef struct {
+    const Corpus *corpus;
+    Result *results;
+    atomic_uint next_file;
+    double timeout;
+    const Tags *tags;    // NULL without -T
+    const Cache *cache;  // NULL without -c
+    CacheKey *keys;      // with -c
+} Job;
+
+typedef struct {
+    const char *source;
+    uint32_t length;
+} StringInput;
+
+typedef struct {
+    double deadline;
+} ParseProgress;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char *read_string(void *payload, uint32_t byte_index, TSPoint position, uint32_t *bytes_read) {
+    (void)position;
+    const StringInput *input = payload;
+    if (byte_index >= input->length) {
+        *bytes_read = 0;
+        return "";
+    }
+    *bytes_read = input->length - byte_index;
+    return input->source + byte_index;
+}
+
+static bool check_deadline(TSParseState *state) {
+    const ParseProgress *progress = state->payload;
+    return now() > progress->deadline;
+}
+
+// Same as test.sh: `wc -l`, the number of newline characters.
+static uint32_t count_lines(const CorpusFile *file) {
+    uint32_t lines = 0;
+    for (uint32_t i = 0; i < file->length; i++) {
+        if (file->source[i] == '\n') lines++;
+    }
+    return lines;
+}
+
+// Collect the ERROR and MISSING nodes, only descending into nodes that contain
+// errors.
+static void collect_errors(TSTree *tree, Result *result) {
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+        if (ts_node_is_error(node) || ts_node_is_missing(node)) {
+            if (result->error_count < CACHE_MAX_ERRORS) {
+                TSPoint start = ts_node_start_point(node);
+                result->errors[result->error_count] = (CacheRange){
+                    ts_node_start_byte(node), ts_node_end_byte(node), start.row, start.column,
+                };
+            }
+            result->error_count++;
+        } else if (ts_node_has_error(node) && ts_tree_cursor_goto_first_child(&cursor)) {
+            continue;
+        }
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return;
+            }
+        }
+    }
+}
+
+// One tag per match that has a name and a kind.
+static void collect_tags(const Tags *tags, TSQueryCursor *cursor, TSTree *tree, Result *result) {
+    uint32_t capacity = 0;
+    CacheTag *list = NULL;
+    ts_query_cursor_exec(cursor, tags->query, ts_tree_root_node(tree));
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor, &match)) {
+        const TSNode *name = NULL;
+        uint32_t kind = UINT32_MAX;
+        for (uint16_t i = 0; i < match.capture_count; i++) {
+            const TSQueryCapture *capture = &match.captures[i];
+            if (capture->index == tags->name_capture) {
+                name = &capture->node;
+            } else if (tags->is_kind[capture->index]) {
+                kind = capture->index;
+            }
+        }
+        if (name == NULL || kind == UINT32_MAX) continue;
+        if (result->tag_count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            list = realloc(list, capacity * sizeof(CacheTag));
+        }
+        TSPoint start = ts_node_start_point(*name);
+        list[result->tag_count++] = (CacheTag){
+            kind, ts_node_start_byte(*name), ts_node_end_byte(*name), start.row, start.column,
+        };
+    }
+    result->tags = list;
+}
+
+static Result validate_file(TSParser *parser, const CorpusFile *file, double timeout, const Tags *tags,
+                            TSQueryCursor *cursor) {
+    Result result = {.kind = RESULT_PASS};
+
+    StringInput string = {file->source, file->length};
+    TSInput input = {
+        .payload = &string,
+        .read = read_string,
+        .encoding = TSInputEncodingUTF8,
+    };
+    ParseProgress progress = {now() + timeout};
+    TSParseOptions options = {
+        .payload = &progress,
+        .progress_callback = check_deadline,
+    };
+    TSTree *tree = ts_parser_parse_with_options(parser, NULL, input, options);
+    if (tree == NULL) {
+        ts_parser_reset(parser);
+        result.kind = RESULT_TIMEOUT;
+        return result;
+    }
+
+    TSNode root = ts_tree_root_node(tree);
+    if (ts_node_has_error(root)) {
+        result.kind = RESULT_ERROR;
+        collect_errors(tree, &result);
+    } else {
+        // A partial parse (scanner can't tokenize something) can silently
+        // produce a truncated tree without errors.
+        uint32_t lines = count_lines(file);
+        uint32_t end_row = ts_node_end_point(root).row;
+        if (lines > 0 && end_row < lines - 1) {
+            result.kind = RESULT_PARTIAL;
+            result.end_row = end_row;
+            result.lines = lines;
+        }
+    }
+
+    if (tags) collect_tags(tags, cursor, tree, &result);
+    ts_tree_delete(tree);
+    return result;
+}
+
+static void *worker(void *arg) {
+    Job *job = arg;
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_fir());
+    TSQueryCursor *cursor = job->tags ? ts_query_cursor_new() : NULL;
+
+    uint32_t i;
+    while ((i = atomic_fetch_add(&job->next_file, 1)) < job->corpus->count) {
+        const CorpusFile *file = &job->corpus->files[i];
+        if (job->cache) {
+            job->keys[i] = cache_key(file->source, file->length);
+            const CacheEntry *entry = cache_lookup(job->cache, job->keys[i]);
+            if (entry) {
+                Result *result = &job->results[i];
+                result->kind = (ResultKind)entry->kind;
+                result->end_row = entry->end_row;
+                result->lines = entry->lines;
+                result->error_count = entry->error_count;
+                memcpy(result->errors, entry->errors, sizeof(entry->errors));
+                result->tags = job->cache->tags + entry->tag_start;
+                result->tag_count = entry->tag_count;
+                result->cached = true;
+                continue;
+            }
+        }
+        job->results[i] = validate_file(parser, file, job->timeout, job->tags, cursor);
+    }
+
+    if (cursor) ts_query_cursor_delete(cursor);
+    ts_parser_delete(parser);
+    return NULL;
+}
+
+// Write the results of this run to the cache, the cached ones included. The
+// old entries of files that aren't in this run are dropped. The cache isn't
+// rewritten if every result came from it and every old entry was used.
+static void update_cache(const char *path, const Cache *old, const Job *job) {
+    uint32_t count = job->corpus->count;
+    CacheEntry *entries = calloc(count ? count : 1, sizeof(CacheEntry));
+    bool *used = calloc(old->count ? old->count : 1, sizeof(bool));
+    uint32_t n = 0, fresh = 0, tag_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        tag_count += job->results[i].tag_count;
+    }
+    CacheTag *tags = malloc((tag_count ? tag_count : 1) * sizeof(CacheTag));
+    tag_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const Result *result = &job->results[i];
+        if (result->kind == RESULT_TIMEOUT) continue;
+        if (result->cached) {
+            used[cache_lookup(old, job->keys[i]) - old->entries] = true;
+        } else {
+            fresh++;
+        }
+        CacheEntry *entry = &entries[n++];
+        entry->key = job->keys[i];
+        entry->kind = result->kind;
+        entry->end_row = result->end_row;
+        entry->lines = result->lines;
+        entry->error_count = result->error_count;
+        memcpy(entry->errors, result->errors, sizeof(entry->errors));
+        entry->tag_start = tag_count;
+        entry->tag_count = result->tag_count;
+        if (result->tag_count) memcpy(tags + tag_count, result->tags, result->tag_count * sizeof(CacheTag));
+        tag_count += result->tag_count;
+    }
+    uint32_t unused = 0;
+    for (uint32_t i = 0; i < old->count; i++) {
+        if (!used[i]) unused++;
+    }
+    uint64_t tags_hash = job->tags ? job->tags->hash : 0;
+    if ((fresh > 0 || unused > 0) && !cache_write(path, FIR_GRAMMAR_FINGERPRINT, tags_hash, entries, n, tags)) {
+        fprintf(stderr, "warning: can't write cache %s\n", path);
+    }
+    free(tags);
+    free(used);
+    free(entries);
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-j JOBS] [-t SECONDS] [-e] [-c CACHE] [-T QUERY] [PATH]\n", program);
+}
+
+static bool load_tags(const char *path, Tags *tags, char **source) {
+    uint32_t length;
+    if (!corpus_read_file(path, source, &length)) {
+        fprintf(stderr, "error: can't read %s\n", path);
+        return false;
+    }
+    uint32_t error_offset;
+    TSQueryError error_type;
+    tags->query = ts_query_new(tree_sitter_fir(), *source, length, &error_offset, &error_type);
+    if (tags->query == NULL) {
+        fprintf(stderr, "error: %s: error %d at byte %u\n", path, error_type, error_offset);
+        return false;
+    }
+    tags->hash = cache_key(*source, length).hash;
+    tags->name_capture = UINT32_MAX;
+    uint32_t capture_count = ts_query_capture_count(tags->query);
+    tags->is_kind = calloc(capture_count ? capture_count : 1, sizeof(bool));
+    for (uint32_t i = 0; i < capture_count; i++) {
+        uint32_t name_length;
+        const char *name = ts_query_capture_name_for_id(tags->query, i, &name_length);
+        if (name_length == 4 && memcmp(name, "name", 4) == 0) {
+            tags->name_capture = i;
+        } else {
+            tags->is_kind[i] = (name_length > 11 && memcmp(name, "definition.", 11) == 0) ||
+                               (name_length > 10 && memcmp(name, "reference.", 10) == 0);
+        }
+    }
+    return true;
+}
+
+static void print_tags(const Tags *tags, const CorpusFile *file, const Result *result) {
+    for (uint32_t i = 0; i < result->tag_count; i++) {
+        const CacheTag *tag = &result->tags[i];
+        uint32_t kind_length;
+        const char *kind = ts_query_capture_name_for_id(tags->query, tag->capture, &kind_length);
+        // A cached tag can't point past the file, which has the same content.
+        printf("    %.*s %.*s (%u, %u)\n", (int)kind_length, kind, (int)(tag->end_byte - tag->start_byte),
+               file->source + tag->start_byte, tag->row, tag->column);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = "../fir";
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    double timeout = 5;
+    bool allow_errors = false;
+    const char *cache_path = NULL;
+    const char *tags_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            timeout = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-e") == 0) {
+            allow_errors = true;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            tags_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (jobs < 1) jobs = 1;
+    if (cache_path && FIR_GRAMMAR_FINGERPRINT[0] == '\0') {
+        fprintf(stderr, "warning: built without FIR_GRAMMAR_FINGERPRINT, not using the cache\n");
+        cache_path = NULL;
+    }
+
+    Tags tags = {0};
+    char *tags_source = NULL;
+    if (tags_path && !load_tags(tags_path, &tags, &tags_source)) return 2;
+
+    Corpus corpus = corpus_load(path);
+    if (corpus.count == 0) {
+        fprintf(stderr, "error: no .fir files found in %s\n", path);
+        return 2;
+    }
+    if ((uint32_t)jobs > corpus.count) jobs = corpus.count;
+
+    Job job = {
+        .corpus = &corpus,
+        .results = calloc(corpus.count, sizeof(Result)),
+        .timeout = timeout,
+        .tags = tags_path ? &tags : NULL,
+    };
+    atomic_init(&job.next_file, 0);
+
+    Cache cache = {0};
+    if (cache_path) {
+        cache_open(&cache, cache_path, FIR_GRAMMAR_FINGERPRINT, tags.hash);
+        job.cache = &cache;
+        job.keys = calloc(corpus.count, sizeof(CacheKey));
+    }
+
+    pthread_t *threads = malloc((size_t)jobs * sizeof(pthread_t));
+    for (long t = 0; t < jobs; t++) {
+        pthread_create(&threads[t], NULL, worker, &job);
+    }
+    for (long t = 0; t < jobs; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    uint32_t pass = 0, fail = 0, cached = 0;
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        const char *file_path = corpus.files[i].path;
+        Result result = job.results[i];
+        if (result.cached) cached++;
+        switch (result.kind) {
+            case RESULT_PASS:
+                printf(GREEN "PASS" RESET " %s\n", file_path);
+                pass++;
+                break;
+            case RESULT_ERROR:
+                if (allow_errors) {
+                    printf(GREEN "PASS" RESET " %s\n", file_path);
+                    pass++;
+                } else if (result.error_count > 0) {
+                    printf(RED "FAIL" RESET " %s (error at line %u, column %u)\n", file_path,
+                           result.errors[0].row + 1, result.errors[0].column + 1);
+                    fail++;
+                } else {
+                    printf(RED "FAIL" RESET " %s\n", file_path);
+                    fail++;
+                }
+                break;
+            case RESULT_PARTIAL:
+                printf(RED "FAIL" RESET " %s (partial parse: tree ends at row %u, file has %u lines)\n",
+                       file_path, result.end_row, result.lines);
+                fail++;
+                break;
+            case RESULT_TIMEOUT:
+                printf(RED "FAIL" RESET " %s (timeout)\n", file_path);
+                fail++;
+                break;
+        }
+        if (tags_path) print_tags(&tags, &corpus.files[i], &result);
+    }
+    if (cache_path) {
+        printf("Cached: %u of %u files\n", cached, corpus.count);
+        update_cache(cache_path, &cache, &job);
+        cache_close(&cache);
+        free(job.keys);
+    }
+    printf("Pass: %u, Fail: %u\n", pass, fail);
+
+    free(threads);
+    for (uint32_t i = 0; i < corpus.count; i++) {
+        if (!job.results[i].cached) free((CacheTag *)job.results[i].tags);
+    }
+    free(job.results);
+    if (tags_path) {
+        ts_query_delete(tags.query);
+        free(tags.is_kind);
+        free(tags_source);
+    }
+    corpus_free(&corpus);
+    return fail > 0 ? 1 : 0;
+}
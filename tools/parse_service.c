@@ -0,0 +1,354 @@
+// Long-running parse service, so that tools don't each start a process, load
+// the grammar and compile the queries for every run.
+//
+// Usage: bench/build/parse_service [-j JOBS] [-q QUERIES] SOCKET
+//
+// Listens on the Unix socket SOCKET. Each connection is served by one of JOBS
+// worker threads (default: number of CPUs), each with its own warm parser and
+// query cursor. The queries in the QUERIES directory (default: queries) are
+// compiled once at startup and shared.
+//
+// A request is one line: a command and the paths of the files, separated by
+// tabs. The commands are:
+//
+//   parse       node count and whether the tree has errors
+//   errors      the ranges of ERROR and MISSING nodes
+//   highlights  the captures of highlights.scm
+//   tags        the captures of tags.scm
+//
+// The response is streamed as JSON lines, one per file in request order, then
+// `{"done": FILES}`. Ranges are `[start_byte, end_byte, start_row,
+// start_column, end_row, end_column]`, captures are `[name, start_byte,
+// end_byte]`. A file that can't be read gets `{"path": ..., "error": ...}`.
+// For example:
+//
+//   printf 'errors\ta.fir\tb.fir\n' | nc -U /tmp/fir.sock
+//
+// The connection stays open for more requests until the client closes it.
+
+#include "../bench/corpus.h"
+
+#include <tree_sitter/api.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+const TSLanguage *tree_sitter_fir(void);
+
+// ==================== Connection queue ====================
+
+typedef struct {
+    int *fds;
+    uint32_t count;
+    uint32_t capacity;
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;
+} Queue;
+
+static void queue_push(Queue *queue, int fd) {
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 16;
+        queue->fds = realloc(queue->fds, queue->capacity * sizeof(int));
+    }
+    queue->fds[queue->count++] = fd;
+    pthread_cond_signal(&queue->ready);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static int queue_pop(Queue *queue) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0) pthread_cond_wait(&queue->ready, &queue->mutex);
+    int fd = queue->fds[0];
+    memmove(queue->fds, queue->fds + 1, --queue->count * sizeof(int));
+    pthread_mutex_unlock(&queue->mutex);
+    return fd;
+}
+
+// ==================== Requests ====================
+
+typedef struct {
+    const TSLanguage *language;
+    const TSQuery *highlights;
+    const TSQuery *tags;
+    Queue queue;
+} Service;
+
+typedef struct {
+    TSParser *parser;
+    TSQueryCursor *cursor;
+} Worker;
+
+typedef enum {
+    COMMAND_PARSE,
+    COMMAND_ERRORS,
+    COMMAND_HIGHLIGHTS,
+    COMMAND_TAGS,
+} Command;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void write_json_string(FILE *out, const char *s, size_t length) {
+    fputc('"', out);
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_range(FILE *out, TSNode node) {
+    TSPoint start = ts_node_start_point(node), end = ts_node_end_point(node);
+    fprintf(out, "[%u, %u, %u, %u, %u, %u]", ts_node_start_byte(node), ts_node_end_byte(node),
+            start.row, start.column, end.row, end.column);
+}
+
+// Write the ranges of the ERROR and MISSING nodes, only descending into nodes
+// that contain errors.
+static void write_errors(FILE *out, TSTree *tree) {
+    fprintf(out, ", \"errors\": [");
+    bool first = true;
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+        if (ts_node_is_error(node) || ts_node_is_missing(node)) {
+            if (!first) fprintf(out, ", ");
+            write_range(out, node);
+            first = false;
+        } else if (ts_node_has_error(node) && ts_tree_cursor_goto_first_child(&cursor)) {
+            continue;
+        }
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) goto done;
+        }
+    }
+done:
+    ts_tree_cursor_delete(&cursor);
+    fprintf(out, "]");
+}
+
+static void write_captures(FILE *out, Worker *worker, const TSQuery *query, TSTree *tree) {
+    fprintf(out, ", \"captures\": [");
+    ts_query_cursor_exec(worker->cursor, query, ts_tree_root_node(tree));
+    TSQueryMatch match;
+    uint32_t capture_index;
+    bool first = true;
+    while (ts_query_cursor_next_capture(worker->cursor, &match, &capture_index)) {
+        TSQueryCapture capture = match.captures[capture_index];
+        uint32_t length;
+        const char *name = ts_query_capture_name_for_id(query, capture.index, &length);
+        fprintf(out, "%s[", first ? "" : ", ");
+        write_json_string(out, name, length);
+        fprintf(out, ", %u, %u]", ts_node_start_byte(capture.node), ts_node_end_byte(capture.node));
+        first = false;
+    }
+    fprintf(out, "]");
+}
+
+static void handle_file(FILE *out, const Service *service, Worker *worker, Command command, const char *path) {
+    fprintf(out, "{\"path\": ");
+    write_json_string(out, path, strlen(path));
+
+    char *source;
+    uint32_t length;
+    if (!corpus_read_file(path, &source, &length)) {
+        fprintf(out, ", \"error\": \"can't read file\"}\n");
+        return;
+    }
+
+    double start = now();
+    TSTree *tree = ts_parser_parse_string(worker->parser, NULL, source, length);
+    double elapsed = now() - start;
+    TSNode root = ts_tree_root_node(tree);
+
+    switch (command) {
+        case COMMAND_PARSE:
+            fprintf(out, ", \"nodes\": %u, \"has_error\": %s, \"ms\": %.3f", ts_node_descendant_count(root),
+                    ts_node_has_error(root) ? "true" : "false", elapsed * 1e3);
+            break;
+        case COMMAND_ERRORS:
+            write_errors(out, tree);
+            break;
+        case COMMAND_HIGHLIGHTS:
+        case COMMAND_TAGS: {
+            const TSQuery *query = command == COMMAND_HIGHLIGHTS ? service->highlights : service->tags;
+            if (query) {
+                write_captures(out, worker, query, tree);
+            } else {
+                fprintf(out, ", \"error\": \"query not loaded\"");
+            }
+            break;
+        }
+    }
+    fprintf(out, "}\n");
+
+    ts_tree_delete(tree);
+    free(source);
+}
+
+static bool parse_command(const char *name, Command *command) {
+    static const struct {
+        const char *name;
+        Command command;
+    } commands[] = {
+        {"parse", COMMAND_PARSE},
+        {"errors", COMMAND_ERRORS},
+        {"highlights", COMMAND_HIGHLIGHTS},
+        {"tags", COMMAND_TAGS},
+    };
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strcmp(name, commands[i].name) == 0) {
+            *command = commands[i].command;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void handle_request(FILE *out, const Service *service, Worker *worker, char *line) {
+    char *saveptr;
+    char *name = strtok_r(line, "\t", &saveptr);
+    Command command;
+    if (name == NULL || !parse_command(name, &command)) {
+        fprintf(out, "{\"error\": \"unknown command\"}\n");
+        return;
+    }
+    uint32_t files = 0;
+    char *path;
+    while ((path = strtok_r(NULL, "\t", &saveptr)) != NULL) {
+        handle_file(out, service, worker, command, path);
+        files++;
+    }
+    fprintf(out, "{\"done\": %u}\n", files);
+}
+
+static void handle_connection(const Service *service, Worker *worker, int fd) {
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, in)) > 0) {
+        if (line[length - 1] == '\n') line[--length] = '\0';
+        if (length > 0 && line[length - 1] == '\r') line[--length] = '\0';
+        if (length == 0) continue;
+        handle_request(out, service, worker, line);
+        if (fflush(out) != 0) break;
+    }
+    free(line);
+    fclose(out);
+    fclose(in);
+}
+
+static void *worker_main(void *arg) {
+    Service *service = arg;
+    Worker worker = {
+        .parser = ts_parser_new(),
+        .cursor = ts_query_cursor_new(),
+    };
+    ts_parser_set_language(worker.parser, service->language);
+
+    for (;;) handle_connection(service, &worker, queue_pop(&service->queue));
+    return NULL;
+}
+
+// ==================== Startup ====================
+
+static TSQuery *load_query(const TSLanguage *language, const char *dir, const char *name) {
+    char path[4096];
+    snprintf(path, sizeof path, "%s/%s", dir, name);
+    char *source;
+    uint32_t length;
+    if (!corpus_read_file(path, &source, &length)) {
+        fprintf(stderr, "warning: can't read %s\n", path);
+        return NULL;
+    }
+    uint32_t error_offset;
+    TSQueryError error_type;
+    TSQuery *query = ts_query_new(language, source, length, &error_offset, &error_type);
+    if (query == NULL) fprintf(stderr, "warning: %s: error %d at byte %u\n", path, error_type, error_offset);
+    free(source);
+    return query;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-j JOBS] [-q QUERIES] SOCKET\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *socket_path = NULL;
+    const char *queries_dir = "queries";
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            queries_dir = argv[++i];
+        } else if (argv[i][0] == '-' || socket_path != NULL) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            socket_path = argv[i];
+        }
+    }
+    if (socket_path == NULL) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (jobs < 1) jobs = 1;
+
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "error: socket path too long: %s\n", socket_path);
+        return 1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    // Clients that disconnect early shouldn't kill the service.
+    signal(SIGPIPE, SIG_IGN);
+
+    Service service = {.language = tree_sitter_fir()};
+    service.highlights = load_query(service.language, queries_dir, "highlights.scm");
+    service.tags = load_query(service.language, queries_dir, "tags.scm");
+    pthread_mutex_init(&service.queue.mutex, NULL);
+    pthread_cond_init(&service.queue.ready, NULL);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof address) != 0 ||
+        listen(listener, 64) != 0) {
+        perror(socket_path);
+        return 1;
+    }
+
+    for (long t = 0; t < jobs; t++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, worker_main, &service);
+        pthread_detach(thread);
+    }
+    fprintf(stderr, "listening on %s with %ld workers\n", socket_path, jobs);
+
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd >= 0) queue_push(&service.queue, fd);
+    }
+}
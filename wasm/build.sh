@@ -0,0 +1,42 @@
+#!/bin/bash
+
+# Builds tree-sitter-fir.wasm, the grammar as a web-tree-sitter module, for
+# browser editors. Unlike `tree-sitter build --wasm` it optimizes for size
+# (`-Os` by default, override with OPT) and exports the external scanner
+# functions along with `tree_sitter_fir`, so they keep their names in
+# profiles.
+#
+# Needs wasi-sdk: set WASI_SDK_PATH (default /opt/wasi-sdk) or CC.
+#
+# Usage: wasm/build.sh [OUTPUT]   (default: tree-sitter-fir.wasm)
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+WASI_SDK_PATH="${WASI_SDK_PATH:-/opt/wasi-sdk}"
+CC="${CC:-$WASI_SDK_PATH/bin/clang}"
+OPT="${OPT:--Os}"
+OUTPUT="${1:-tree-sitter-fir.wasm}"
+
+EXPORTS=(
+    tree_sitter_fir
+    tree_sitter_fir_external_scanner_create
+    tree_sitter_fir_external_scanner_destroy
+    tree_sitter_fir_external_scanner_serialize
+    tree_sitter_fir_external_scanner_deserialize
+    tree_sitter_fir_external_scanner_scan
+)
+EXPORT_FLAGS=()
+for symbol in "${EXPORTS[@]}"; do
+    EXPORT_FLAGS+=("-Wl,--export=$symbol")
+done
+
+# malloc, free etc. are imported from the web-tree-sitter runtime, hence
+# -nostdlib and --allow-undefined.
+$CC --target=wasm32-unknown-wasi $OPT -fPIC -shared -nostdlib \
+    -fno-exceptions -fvisibility=hidden \
+    -Wl,--no-entry -Wl,--allow-undefined -Wl,--strip-debug "${EXPORT_FLAGS[@]}" \
+    -Isrc src/parser.c src/scanner.c -o "$OUTPUT"
+
+echo "$OUTPUT: $(wc -c < "$OUTPUT") bytes"
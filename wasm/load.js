@@ -0,0 +1,33 @@
+// Loads the Fir grammar in the browser with web-tree-sitter.
+//
+// Call `loadFir()` as early as possible, e.g. from a module script in the
+// page's <head>. It starts downloading the grammar and initializing the
+// web-tree-sitter runtime in parallel, while the rest of the page loads, and
+// returns a promise of the `Language`. Later calls return the same promise.
+//
+// This doesn't use streaming compilation (`WebAssembly.compileStreaming`),
+// because web-tree-sitter can't load a compiled module. `Language.load` (0.25)
+// only takes a URL, which it fetches itself, or the module's bytes. It passes
+// the bytes to Emscripten's `loadWebAssemblyModule`, which compiles them with
+// `WebAssembly.instantiate`. A `WebAssembly.Module` passed in is taken as a
+// URL. So the module is only compiled once its last byte has arrived. What
+// overlaps instead is the download with the runtime's initialization. The
+// compilation is asynchronous and doesn't block the page.
+
+import { Language, Parser } from "web-tree-sitter";
+
+let language = null;
+
+export function loadFir(url = new URL("../tree-sitter-fir.wasm", import.meta.url)) {
+  if (language === null) {
+    const bytes = fetch(url).then((response) => {
+      if (!response.ok) {
+        throw new Error(`Failed to fetch ${url}: ${response.status}`);
+      }
+      return response.arrayBuffer();
+    });
+    language = Promise.all([Parser.init(), bytes])
+      .then(([, bytes]) => Language.load(new Uint8Array(bytes)));
+  }
+  return language;
+}